@@ -3,6 +3,58 @@
 
 import PackageDescription
 
+var products: [Product] = [
+  .library(
+    name: "MetalFloat64Core",
+    targets: ["MetalFloat64Core"]),
+]
+
+var targets: [Target] = [
+  // Header-only C99/OpenCL/MSL arithmetic core. The test suite runs the C
+  // branch on the host, which also works on Linux, and the MSL branch through
+  // "metal_float64". The build script only type-checks the OpenCL branch.
+  .target(
+    name: "MetalFloat64Core",
+    exclude: [
+      "tests/OpenCLTests.cl",
+    ],
+    sources: [
+      "src/MetalFloat64Core.c",
+    ]),
+  .testTarget(
+    name: "MetalFloat64CoreTests",
+    dependencies: ["MetalFloat64Core"]),
+]
+
+#if !os(Linux)
+products.append(
+  .library(
+    name: "MetalAtomic64",
+    type: .dynamic,
+    targets: ["MetalAtomic64"]))
+
+targets.append(contentsOf: [
+  .target(
+    name: "MetalAtomic64",
+    exclude: [
+      // Xcode will not let us include "src/Atomic.metal" as a typical
+      // resource. It always invokes the Metal compiler on the file. To work
+      // around this, we embed Metal sources into the original Swift file.
+      // The build script embeds the sources automatically.
+      "src/Atomic.metal",
+    ],
+    sources: [
+      "src/GenerateLibrary.swift",
+    ]),
+  .testTarget(
+    name: "MetalFloat64Tests",
+    dependencies: ["MetalAtomic64", "MetalFloat64Core"],
+    resources: [
+      .copy("Resources/")
+    ]),
+])
+#endif
+
 let package = Package(
   name: "MetalFloat64",
   platforms: [
@@ -10,31 +62,7 @@ let package = Package(
     .iOS(.v16),
     .tvOS(.v16)
   ],
-  products: [
-    .library(
-      name: "MetalAtomic64",
-      type: .dynamic,
-      targets: ["MetalAtomic64"])
-  ],
+  products: products,
   dependencies: [],
-  targets: [
-    .target(
-      name: "MetalAtomic64",
-      exclude: [
-        // Xcode will not let us include "src/Atomic.metal" as a typical
-        // resource. It always invokes the Metal compiler on the file. To work
-        // around this, we embed Metal sources into the original Swift file.
-        // The build script embeds the sources automatically.
-        "src/Atomic.metal",
-      ],
-      sources: [
-        "src/GenerateLibrary.swift",
-      ]),
-    .testTarget(
-      name: "MetalFloat64Tests",
-      dependencies: ["MetalAtomic64"],
-      resources: [
-        .copy("Resources/")
-      ]),
-  ]
+  targets: targets
 )
@@ -48,6 +48,9 @@
 ///
 /// - Parameters:
 ///   - float64_library: The MetalFloat64 library to link against.
+///   - configuration: The size of the lock buffer, and how addresses map onto
+///     it. Defaults to a single shard of 2^16 locks. From C, call
+///     `metal_atomic64_generate_library_with_configuration` instead.
 ///   - atomic64_library: The MetalAtomic64 library your client code will call
 ///     into.
 ///   - lock_buffer: The lock buffer whose base address is encoded into
@@ -55,4 +58,46 @@
 void metal_atomic64_generate_library(
   const void *float64_library, void **atomic64_library, void **lock_buffer);
 
+/// How the atomics library maps an object's address to a lock within its
+/// shard. Matches `MetalAtomic64LockHash` in Swift.
+///
+/// - METAL_ATOMIC64_LOCK_HASH_XOR_MASK: XORs the address's 8-byte word index
+///   with a constant. Objects a multiple of `locks_per_shard` words apart
+///   always share a lock.
+/// - METAL_ATOMIC64_LOCK_HASH_MULTIPLICATIVE: Fibonacci hashing. Spreads out
+///   power-of-two strides, at the cost of one integer multiply.
+enum {
+  METAL_ATOMIC64_LOCK_HASH_XOR_MASK = 0,
+  METAL_ATOMIC64_LOCK_HASH_MULTIPLICATIVE = 1,
+};
+
+/// Same as `metal_atomic64_generate_library`, but with a custom lock table.
+/// The table holds `shard_count` shards of `locks_per_shard` 4-byte locks.
+/// Every aligned `shard_size`-byte range of addresses maps to one shard. Up to
+/// `shard_count` adjacent ranges get separate shards, so resources in them
+/// never contend for the same lock. The mapping wraps around every
+/// `shard_count * shard_size` bytes, and ranges that far apart share a shard.
+/// The values are baked into the shader as compile-time constants.
+///
+/// Scatter-heavy workloads with many objects in flight want more locks, to
+/// reduce false contention. Small GPUs may want fewer, to save memory. The
+/// default is one shard of 2^16 locks, with the XOR hash.
+///
+/// - Parameters:
+///   - float64_library: The MetalFloat64 library to link against.
+///   - locks_per_shard: A power of two from 2^8 to 2^24.
+///   - shard_count: A power of two from 1 to 2^8. There may be at most 2^26
+///     locks in total.
+///   - shard_size: A power of two from 8 bytes to 2^62 bytes. Ignored when
+///     there is only one shard.
+///   - lock_hash: One of the `METAL_ATOMIC64_LOCK_HASH_*` constants.
+///   - atomic64_library: The MetalAtomic64 library your client code will call
+///     into.
+///   - lock_buffer: The lock buffer whose base address is encoded into
+///     `atomic64_library`.
+void metal_atomic64_generate_library_with_configuration(
+  const void *float64_library, unsigned int locks_per_shard,
+  unsigned int shard_count, unsigned long long shard_size,
+  unsigned int lock_hash, void **atomic64_library, void **lock_buffer);
+
 #endif /* MetalAtomic64_h */
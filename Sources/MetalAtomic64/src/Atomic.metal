@@ -71,6 +71,34 @@ static constant size_t lock_buffer_address = 0;
 static constant size_t lock_buffer_address = METAL_ATOMIC64_LOCK_BUFFER_ADDRESS;
 #endif
 
+// Layout of the lock table, set by `MetalAtomic64LockConfiguration` on the
+// host. The defaults match the placeholder library: one shard of 2^16 locks,
+// with the XOR hash.
+//
+// The table holds (1 << SHARD_COUNT_LOG2) shards of (1 << LOCK_COUNT_LOG2)
+// locks each. Bits [SHARD_SIZE_LOG2, SHARD_SIZE_LOG2 + SHARD_COUNT_LOG2) of
+// the address select the shard. Up to (1 << SHARD_COUNT_LOG2) adjacent ranges
+// get separate shards, then the mapping wraps around, so ranges that are a
+// multiple of the shard count apart share a shard and may contend.
+#ifndef METAL_ATOMIC64_LOCK_COUNT_LOG2
+#define METAL_ATOMIC64_LOCK_COUNT_LOG2 16
+#endif
+#ifndef METAL_ATOMIC64_SHARD_COUNT_LOG2
+#define METAL_ATOMIC64_SHARD_COUNT_LOG2 0
+#endif
+#ifndef METAL_ATOMIC64_SHARD_SIZE_LOG2
+#define METAL_ATOMIC64_SHARD_SIZE_LOG2 30
+#endif
+
+// 0 - XOR the word index with a constant, like desul. Addresses a multiple of
+//     the shard's lock count apart (in 8-byte words) always collide.
+// 1 - Fibonacci hashing: multiply the word index by 2^32 / golden ratio, then
+//     take the upper bits. Spreads out power-of-two strides, at the cost of an
+//     integer multiply.
+#ifndef METAL_ATOMIC64_LOCK_HASH
+#define METAL_ATOMIC64_LOCK_HASH 0
+#endif
+
 struct LockBufferAddressWrapper {
   device atomic_uint* address;
 };
@@ -81,13 +109,31 @@ struct DeviceAddressWrapper {
 
 // This assumes the object is aligned to 8 bytes (the address's lower 3 bits
 // are all zeroes). Otherwise, behavior is undefined.
+//
+// NOTE: Ensure this stays synchronized with `lockIndex(address:)` in
+// "GenerateLibrary.swift".
 INTERNAL_INLINE device atomic_uint* get_lock(device ulong* object) {
   DeviceAddressWrapper wrapper{ (device atomic_uint*)object };
-  uint lower_bits = reinterpret_cast<thread uint2&>(wrapper)[0];
-  uint hash = extract_bits(lower_bits, 1, 18) ^ (0x5A39 << 2);
+  uint2 address_bits = reinterpret_cast<thread uint2&>(wrapper);
+  uint word_index = extract_bits(address_bits[0], 3, 29) | (address_bits[1] << 29);
+  
+  constexpr uint lock_mask = (1 << METAL_ATOMIC64_LOCK_COUNT_LOG2) - 1;
+#if METAL_ATOMIC64_LOCK_HASH == 0
+  uint lock_index = (word_index & lock_mask) ^ (0x5A39 & lock_mask);
+#else
+  uint lock_index = (word_index * 0x9E3779B9) >> (32 - METAL_ATOMIC64_LOCK_COUNT_LOG2);
+#endif
+  
+#if METAL_ATOMIC64_SHARD_COUNT_LOG2 > 0
+  constexpr uint shard_mask = (1 << METAL_ATOMIC64_SHARD_COUNT_LOG2) - 1;
+  ulong address = as_type<ulong>(address_bits);
+  uint shard = uint(address >> METAL_ATOMIC64_SHARD_SIZE_LOG2) & shard_mask;
+  lock_index |= shard << METAL_ATOMIC64_LOCK_COUNT_LOG2;
+#endif
   
-  // TODO: Explicitly, OR only the lower 32 bits (this currently sign extends).
-  auto this_address = lock_buffer_address | hash;
+  // The lock buffer is aligned to its size, so the offset only fills in the
+  // base address's lower bits.
+  auto this_address = lock_buffer_address | ulong(lock_index << 2);
   auto lock_ref = reinterpret_cast<thread LockBufferAddressWrapper&>
      (this_address);
   return lock_ref.address;
@@ -13,16 +13,43 @@ public func metal_atomic64_generate_library(
   _ float64_library: UnsafeRawPointer?,
   _ atomic64_library: UnsafeMutablePointer<UnsafeMutableRawPointer?>,
   _ lock_buffer: UnsafeMutablePointer<UnsafeMutableRawPointer?>
+) {
+  let configuration = MetalAtomic64LockConfiguration()
+  metal_atomic64_generate_library_with_configuration(
+    float64_library, UInt32(configuration.locksPerShard),
+    UInt32(configuration.shardCount), UInt64(configuration.shardSize),
+    configuration.hash.rawValue, atomic64_library, lock_buffer)
+}
+
+@_cdecl("metal_atomic64_generate_library_with_configuration")
+public func metal_atomic64_generate_library_with_configuration(
+  _ float64_library: UnsafeRawPointer?,
+  _ locks_per_shard: UInt32,
+  _ shard_count: UInt32,
+  _ shard_size: UInt64,
+  _ lock_hash: UInt32,
+  _ atomic64_library: UnsafeMutablePointer<UnsafeMutableRawPointer?>,
+  _ lock_buffer: UnsafeMutablePointer<UnsafeMutableRawPointer?>
 ) {
   // Accept float64_library reference at +0.
   let _float64_library = Unmanaged<MTLDynamicLibrary>
     .fromOpaque(float64_library!).takeUnretainedValue()
+  guard let hash = MetalAtomic64LockHash(rawValue: lock_hash) else {
+    fatalError("Invalid lock hash: \(lock_hash)")
+  }
+  // Check before converting, which would trap on values above `Int.max`.
+  precondition(
+    shard_size <= UInt64(1) << 62,
+    "Shard size must be a power of two from 8 bytes to 2^62 bytes.")
+  let configuration = MetalAtomic64LockConfiguration(
+    locksPerShard: Int(locks_per_shard), shardCount: Int(shard_count),
+    shardSize: Int(shard_size), hash: hash)
   
   // Call into Swift version of the function (not visible from C). We make a
   // separate function for C because otherwise, it might incorrectly reference-
   // count the return values.
-  let (_atomic64_library, _lock_buffer) =
-    metal_atomic64_generate_library(_float64_library)
+  let (_atomic64_library, _lock_buffer) = metal_atomic64_generate_library(
+    _float64_library, configuration: configuration)
   
   // Return outputs at +1.
   atomic64_library.pointee = Unmanaged<MTLDynamicLibrary>
@@ -32,6 +59,153 @@ public func metal_atomic64_generate_library(
 }
 #endif
 
+// MARK: - Lock Table
+
+/// How `get_lock` maps an object's address to a lock within its shard.
+///
+/// NOTE: Ensure the raw values stay synchronized with
+/// `METAL_ATOMIC64_LOCK_HASH` in the shader and the C header.
+public enum MetalAtomic64LockHash: UInt32 {
+  /// XORs the address's 8-byte word index with a constant, like Kokkos's desul
+  /// lock arrays. Neighboring objects get neighboring locks, but objects a
+  /// multiple of `locksPerShard` words apart always share a lock.
+  case xorMask = 0
+  
+  /// Multiplies the word index by 2^32 / golden ratio (Fibonacci hashing), then
+  /// takes the upper bits. Power-of-two strides spread across the whole shard,
+  /// at the cost of one integer multiply.
+  case multiplicative = 1
+}
+
+/// Size and layout of the lock buffer, which `metal_atomic64_generate_library`
+/// bakes into the shader as compile-time constants.
+///
+/// The buffer holds `shardCount` shards of `locksPerShard` 4-byte locks. Every
+/// aligned `shardSize`-byte range of addresses maps to one shard, cycling
+/// through the shards. Up to `shardCount` adjacent ranges get separate shards,
+/// so resources in them never contend for the same lock. The mapping wraps
+/// around every `shardCount * shardSize` bytes, and ranges that far apart
+/// share a shard. Within a shard, `hash` selects the lock.
+///
+/// Scatter-heavy workloads with many objects in flight want more locks, to
+/// reduce false contention. Small GPUs may want fewer, to save memory. Use
+/// `collisionRate(addresses:)` to estimate the effect of a configuration
+/// before compiling it.
+public struct MetalAtomic64LockConfiguration {
+  /// Number of locks in each shard. Must be a power of two from 2^8 to 2^24.
+  public var locksPerShard: Int
+  
+  /// Number of shards. Must be a power of two from 1 to 2^8, with at most 2^26
+  /// locks in total.
+  public var shardCount: Int
+  
+  /// Bytes of address space that map to each shard. Must be a power of two
+  /// from 8 bytes to 2^62 bytes. Ignored when there is only one shard.
+  public var shardSize: Int
+  
+  public var hash: MetalAtomic64LockHash
+  
+  /// The default matches the placeholder library: a single shard with 2^16
+  /// locks, hashed with `xorMask`.
+  public init(
+    locksPerShard: Int = 1 << 16,
+    shardCount: Int = 1,
+    shardSize: Int = 1 << 30,
+    hash: MetalAtomic64LockHash = .xorMask
+  ) {
+    self.locksPerShard = locksPerShard
+    self.shardCount = shardCount
+    self.shardSize = shardSize
+    self.hash = hash
+  }
+  
+  /// Total number of locks across all shards.
+  public var lockCount: Int {
+    locksPerShard * shardCount
+  }
+  
+  /// Size of the lock table in bytes. The allocated buffer is twice this, so
+  /// the table can be aligned to its size.
+  public var lockTableSize: Int {
+    lockCount * MemoryLayout<UInt32>.stride
+  }
+  
+  private var locksPerShardLog2: Int { locksPerShard.trailingZeroBitCount }
+  private var shardCountLog2: Int { shardCount.trailingZeroBitCount }
+  private var shardSizeLog2: Int { shardSize.trailingZeroBitCount }
+  
+  func validate() {
+    func isPowerOf2(_ x: Int) -> Bool { x > 0 && x & (x - 1) == 0 }
+    precondition(
+      isPowerOf2(locksPerShard) && (8...24).contains(locksPerShardLog2),
+      "Locks per shard must be a power of two from 2^8 to 2^24.")
+    precondition(
+      isPowerOf2(shardCount) && shardCountLog2 <= 8,
+      "Shard count must be a power of two from 1 to 2^8.")
+    precondition(
+      isPowerOf2(shardSize) && (3...62).contains(shardSizeLog2),
+      "Shard size must be a power of two from 8 bytes to 2^62 bytes.")
+    
+    // Lock offsets are computed with 32-bit integers in the shader.
+    precondition(
+      locksPerShardLog2 + shardCountLog2 <= 26,
+      "The lock table cannot exceed 2^26 locks (256 MB).")
+  }
+  
+  var preprocessorMacros: [String: NSNumber] {
+    [
+      "METAL_ATOMIC64_LOCK_COUNT_LOG2": NSNumber(value: locksPerShardLog2),
+      "METAL_ATOMIC64_SHARD_COUNT_LOG2": NSNumber(value: shardCountLog2),
+      "METAL_ATOMIC64_SHARD_SIZE_LOG2": NSNumber(value: shardSizeLog2),
+      "METAL_ATOMIC64_LOCK_HASH": NSNumber(value: hash.rawValue),
+    ]
+  }
+  
+  /// The index of the lock (in 4-byte units from the start of the table) that
+  /// guards the 8-byte object at `address`. Always less than `lockCount`.
+  /// The configuration must be valid, which this does not check.
+  ///
+  /// NOTE: Ensure this stays synchronized with `get_lock` in the shader.
+  public func lockIndex(address: UInt64) -> Int {
+    let wordIndex = UInt32(truncatingIfNeeded: address >> 3)
+    let lockMask = UInt32(locksPerShard - 1)
+    var lockIndex: UInt32
+    switch hash {
+    case .xorMask:
+      lockIndex = (wordIndex & lockMask) ^ (0x5A39 & lockMask)
+    case .multiplicative:
+      lockIndex = (wordIndex &* 0x9E3779B9) >> UInt32(32 - locksPerShardLog2)
+    }
+    
+    if shardCount > 1 {
+      let shardMask = UInt32(shardCount - 1)
+      let shard = UInt32(truncatingIfNeeded: address >> shardSizeLog2)
+      lockIndex |= (shard & shardMask) << UInt32(locksPerShardLog2)
+    }
+    return Int(lockIndex)
+  }
+  
+  /// The fraction of distinct objects that share a lock with at least one
+  /// other object in `addresses`. When those objects are updated at the same
+  /// time, this approximates how often an atomic waits on an unrelated one.
+  public func collisionRate<S: Sequence>(
+    addresses: S
+  ) -> Double where S.Element == UInt64 {
+    validate()
+    var objectsPerLock: [Int: Int] = [:]
+    var objectCount = 0
+    for address in Set(addresses) {
+      objectsPerLock[lockIndex(address: address), default: 0] += 1
+      objectCount += 1
+    }
+    guard objectCount > 0 else {
+      return 0
+    }
+    let colliding = objectsPerLock.values.filter { $0 > 1 }.reduce(0, +)
+    return Double(colliding) / Double(objectCount)
+  }
+}
+
 // NOTE: Ensure this documentation comment stays synchronized with the C header.
 
 /// Compile a 64-bit atomics library that embeds the lock buffer's GPU virtual
@@ -71,12 +245,16 @@ public func metal_atomic64_generate_library(
 ///
 /// - Parameters:
 ///   - float64_library: The MetalFloat64 library to link against.
+///   - configuration: The size of the lock buffer, and how addresses map onto
+///     it. Defaults to a single shard of 2^16 locks. From C, call
+///     `metal_atomic64_generate_library_with_configuration` instead.
 ///   - atomic64_library: The MetalAtomic64 library your client code will call
 ///     into.
 ///   - lock_buffer: The lock buffer whose base address is encoded into
 ///     `atomic64_library`.
 public func metal_atomic64_generate_library(
-  _ float64_library: MTLDynamicLibrary
+  _ float64_library: MTLDynamicLibrary,
+  configuration: MetalAtomic64LockConfiguration = .init()
 ) -> (
   atomic64_library: MTLDynamicLibrary,
   lock_buffer: MTLBuffer
@@ -85,7 +263,8 @@ public func metal_atomic64_generate_library(
   let device = float64_library.device
   
   // Actual buffer size is twice this, for reasons explained below.
-  let lockBufferSize = 1 << 16 * MemoryLayout<UInt32>.stride
+  configuration.validate()
+  let lockBufferSize = configuration.lockTableSize
   let bufferStorageMode = device.hasUnifiedMemory
     ? MTLResourceOptions.storageModeShared : .storageModePrivate
   let lockBuffer = device.makeBuffer(
@@ -101,9 +280,10 @@ public func metal_atomic64_generate_library(
   let options = MTLCompileOptions()
   options.libraries = [float64_library]
   options.optimizationLevel = .size
-  options.preprocessorMacros = [
-    "METAL_ATOMIC64_LOCK_BUFFER_ADDRESS": NSNumber(value: lockBufferAddress)
-  ]
+  var macros = configuration.preprocessorMacros
+  macros["METAL_ATOMIC64_LOCK_BUFFER_ADDRESS"] = NSNumber(
+    value: lockBufferAddress)
+  options.preprocessorMacros = macros
   options.libraryType = .dynamic
   options.installName = "@loader_path/libMetalAtomic64.metallib"
   let atomic64Library_raw = try! device.makeLibrary(
@@ -188,6 +368,34 @@ static constant size_t lock_buffer_address = 0;
 static constant size_t lock_buffer_address = METAL_ATOMIC64_LOCK_BUFFER_ADDRESS;
 #endif
 
+// Layout of the lock table, set by `MetalAtomic64LockConfiguration` on the
+// host. The defaults match the placeholder library: one shard of 2^16 locks,
+// with the XOR hash.
+//
+// The table holds (1 << SHARD_COUNT_LOG2) shards of (1 << LOCK_COUNT_LOG2)
+// locks each. Bits [SHARD_SIZE_LOG2, SHARD_SIZE_LOG2 + SHARD_COUNT_LOG2) of
+// the address select the shard. Up to (1 << SHARD_COUNT_LOG2) adjacent ranges
+// get separate shards, then the mapping wraps around, so ranges that are a
+// multiple of the shard count apart share a shard and may contend.
+#ifndef METAL_ATOMIC64_LOCK_COUNT_LOG2
+#define METAL_ATOMIC64_LOCK_COUNT_LOG2 16
+#endif
+#ifndef METAL_ATOMIC64_SHARD_COUNT_LOG2
+#define METAL_ATOMIC64_SHARD_COUNT_LOG2 0
+#endif
+#ifndef METAL_ATOMIC64_SHARD_SIZE_LOG2
+#define METAL_ATOMIC64_SHARD_SIZE_LOG2 30
+#endif
+
+// 0 - XOR the word index with a constant, like desul. Addresses a multiple of
+//     the shard's lock count apart (in 8-byte words) always collide.
+// 1 - Fibonacci hashing: multiply the word index by 2^32 / golden ratio, then
+//     take the upper bits. Spreads out power-of-two strides, at the cost of an
+//     integer multiply.
+#ifndef METAL_ATOMIC64_LOCK_HASH
+#define METAL_ATOMIC64_LOCK_HASH 0
+#endif
+
 struct LockBufferAddressWrapper {
   device atomic_uint* address;
 };
@@ -198,13 +406,31 @@ struct DeviceAddressWrapper {
 
 // This assumes the object is aligned to 8 bytes (the address's lower 3 bits
 // are all zeroes). Otherwise, behavior is undefined.
+//
+// NOTE: Ensure this stays synchronized with `lockIndex(address:)` in
+// "GenerateLibrary.swift".
 INTERNAL_INLINE device atomic_uint* get_lock(device ulong* object) {
   DeviceAddressWrapper wrapper{ (device atomic_uint*)object };
-  uint lower_bits = reinterpret_cast<thread uint2&>(wrapper)[0];
-  uint hash = extract_bits(lower_bits, 1, 18) ^ (0x5A39 << 2);
+  uint2 address_bits = reinterpret_cast<thread uint2&>(wrapper);
+  uint word_index = extract_bits(address_bits[0], 3, 29) | (address_bits[1] << 29);
+  
+  constexpr uint lock_mask = (1 << METAL_ATOMIC64_LOCK_COUNT_LOG2) - 1;
+#if METAL_ATOMIC64_LOCK_HASH == 0
+  uint lock_index = (word_index & lock_mask) ^ (0x5A39 & lock_mask);
+#else
+  uint lock_index = (word_index * 0x9E3779B9) >> (32 - METAL_ATOMIC64_LOCK_COUNT_LOG2);
+#endif
+  
+#if METAL_ATOMIC64_SHARD_COUNT_LOG2 > 0
+  constexpr uint shard_mask = (1 << METAL_ATOMIC64_SHARD_COUNT_LOG2) - 1;
+  ulong address = as_type<ulong>(address_bits);
+  uint shard = uint(address >> METAL_ATOMIC64_SHARD_SIZE_LOG2) & shard_mask;
+  lock_index |= shard << METAL_ATOMIC64_LOCK_COUNT_LOG2;
+#endif
   
-  // TODO: Explicitly, OR only the lower 32 bits (this currently sign extends).
-  auto this_address = lock_buffer_address | hash;
+  // The lock buffer is aligned to its size, so the offset only fills in the
+  // base address's lower bits.
+  auto this_address = lock_buffer_address | ulong(lock_index << 2);
   auto lock_ref = reinterpret_cast<thread LockBufferAddressWrapper&>
      (this_address);
   return lock_ref.address;
@@ -284,7 +510,9 @@ enum __metal_atomic64_type_id: ushort {
   u64 = 1, // unsigned long
   f64 = 2, // IEEE double precision
   f59 = 3, // 59-bit reduced precision
-  f43 = 4 // 43-bit reduced precision
+  f43 = 4, // 43-bit reduced precision
+  f32x2 = 5, // double-single approach
+  f32 = 6, // software-emulated single precision for validation
 };
 
 // Entering an invalid operation ID causes undefined behavior at runtime.
@@ -294,7 +522,7 @@ enum __metal_atomic64_operation_id: ushort {
   xchg = 2, // atomic_exchange_explicit
   logical_and = 3, // atomic_fetch_and_explicit
   logical_or = 4, // atomic_fetch_or_explicit
-  logical_xor = 5 // atomic_fetch_xor_explicit
+  logical_xor = 5, // atomic_fetch_xor_explicit
 };
 
 // TODO: You can't just implement atomics through a threadgroup barrier. In
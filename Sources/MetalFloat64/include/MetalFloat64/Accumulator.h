@@ -0,0 +1,278 @@
+// MARK: - Accumulator.h
+
+namespace metal_float64
+{
+// `float64_t` stores numbers in the packed IEEE format, so every arithmetic
+// operation must unpack its operands, then normalize, round, and repack the
+// result. `float64_accum_t` keeps numbers unpacked between operations:
+//
+//   value = (-1)^sign * mantissa * 2^exponent
+//
+// The leading one of a nonzero mantissa always sits at bit 61. That leaves 2
+// bits of headroom, so additions of like-signed numbers only ever need a 1-bit
+// shift instead of a full normalization. Exponents are 32-bit, so intermediate
+// results never overflow or underflow. Rounding to 53 bits, denormals, and
+// repacking only happen when converting back to `float64_t`, which includes
+// storing to memory.
+//
+// Error bounds:
+// - Each operation truncates its exact result to 62 bits, jamming any lost
+//   bits into bit 0. The relative error per operation is at most 2^-60.
+// - A single operation followed by a conversion is correctly rounded, matching
+//   IEEE `double` bit for bit.
+// - A chain of N operations accumulates at most N * 2^-60 error before the
+//   final rounding. The error is relative to the magnitudes of the operands
+//   and intermediate results, not the final result. For a sum of N products,
+//   it is bounded by N * 2^-60 * sum(|a_i * b_i|). Chains of up to 128
+//   operations stay within 1 ulp only when the terms do not cancel. Results
+//   may differ from a sequence of `double` operations, because the
+//   intermediate results are never rounded to 53 bits.
+// - Intermediate exponents must stay within +/-2^29. This only matters for
+//   extremely long chains of multiplications, e.g. squaring a number 20 times.
+//
+// Example:
+//
+//   // Unpacks `x` once, then repacks `y` once.
+//   float64_accum_t y = coefficients[4];
+//   y = y * x + coefficients[3];
+//   y = y * x + coefficients[2];
+//   y = y * x + coefficients[1];
+//   y = y * x + coefficients[0];
+//   output[tid] = y;
+class float64_accum_t {
+public:
+  // Must be public as an internal implementation detail, but the user should
+  // never access these properties.
+  ulong mantissa;
+  int exponent;
+  uint sign;
+
+  // Zero has the smallest possible exponent, so it never anchors an addition.
+  // INF and NAN have the largest, and are distinguished by whether the
+  // mantissa is zero. NAN keeps its payload in the mantissa.
+  enum : int {
+    zero_exponent = MF64_ZERO_EXPONENT,
+    special_exponent = MF64_SPECIAL_EXPONENT
+  };
+
+  float64_accum_t() = default;
+
+  float64_accum_t(float64_t x);
+
+  float64_accum_t(float x);
+
+  // Shifts the leading one to bit 61. The mantissa must be below 2^62.
+  void normalize();
+
+  // Rounds to nearest even, then repacks.
+  operator float64_t() const;
+
+  thread float64_accum_t &operator+=(float64_accum_t rhs);
+  thread float64_accum_t &operator-=(float64_accum_t rhs);
+  thread float64_accum_t &operator*=(float64_accum_t rhs);
+};
+
+// How conversions handle results that are not exactly representable.
+enum class rounding_mode {
+  // Round to nearest, ties to even. Overflows to INF.
+  nearest = MF64_ROUND_NEAREST,
+
+  // Round toward zero. Overflows to the largest finite number.
+  truncate = MF64_ROUND_TRUNCATE
+};
+
+namespace
+{
+// Same layout as `mf64_accum_t`, like the conversions in "Double.h".
+METAL_FUNC mf64_accum_t __core(float64_accum_t x)
+{
+  mf64_accum_t output;
+  output.mantissa = x.mantissa;
+  output.exponent = x.exponent;
+  output.sign = x.sign;
+  return output;
+}
+
+METAL_FUNC float64_accum_t __float64_accum(mf64_accum_t x)
+{
+  float64_accum_t output;
+  output.mantissa = x.mantissa;
+  output.exponent = x.exponent;
+  output.sign = x.sign;
+  return output;
+}
+
+// Rounds to an IEEE-style format with `ExponentBits` exponent bits and
+// `FractionBits` explicit mantissa bits, then returns its bit pattern.
+template <uint ExponentBits, uint FractionBits, rounding_mode Mode>
+METAL_FUNC ulong __float64_accum_round(float64_accum_t x)
+{
+  return mf64_accum_round(
+    __core(x), ExponentBits, FractionBits, mf64_rounding_mode_t(Mode));
+}
+} // namespace
+
+METAL_FUNC float64_accum_t::float64_accum_t(float64_t x)
+{
+  *this = __float64_accum(mf64_accum_from_float64(__core(x)));
+}
+
+METAL_FUNC float64_accum_t::float64_accum_t(float x)
+{
+  *this = __float64_accum(mf64_accum_from_float(x));
+}
+
+METAL_FUNC void float64_accum_t::normalize()
+{
+  *this = __float64_accum(mf64_accum_normalize(__core(*this)));
+}
+
+METAL_FUNC float64_accum_t::operator float64_t() const
+{
+  float64_t output;
+  output.data = __float64_accum_round<11, 52, rounding_mode::nearest>(*this);
+  return output;
+}
+
+METAL_FUNC float64_accum_t operator-(float64_accum_t x)
+{
+  return __float64_accum(mf64_accum_negate(__core(x)));
+}
+
+namespace
+{
+METAL_FUNC float64_accum_t __float64_accum_add
+ (
+  float64_accum_t a, float64_accum_t b)
+{
+  return __float64_accum(mf64_accum_add(__core(a), __core(b)));
+}
+
+METAL_FUNC float64_accum_t __float64_accum_multiply
+ (
+  float64_accum_t a, float64_accum_t b)
+{
+  return __float64_accum(mf64_accum_multiply(__core(a), __core(b)));
+}
+
+// The FP64*FP32 path, which skips the full 64-bit `mulhi`.
+METAL_FUNC float64_accum_t __float64_accum_multiply
+ (
+  float64_accum_t a, float b)
+{
+  return __float64_accum(mf64_accum_multiply_float(__core(a), b));
+}
+
+METAL_FUNC float64_accum_t __float64_accum_multiply
+ (
+  float a, float64_accum_t b)
+{
+  return __float64_accum_multiply(b, a);
+}
+} // namespace
+
+// Overloads for mixed operands prevent ambiguity with the `float64_t`
+// operators below.
+#define FLOAT64_ACCUM_OPERATORS(LHS, RHS) \
+METAL_FUNC float64_accum_t operator+(LHS lhs, RHS rhs) \
+{ \
+  return __float64_accum_add(lhs, rhs); \
+} \
+METAL_FUNC float64_accum_t operator-(LHS lhs, RHS rhs) \
+{ \
+  return __float64_accum_add(lhs, -float64_accum_t(rhs)); \
+} \
+METAL_FUNC float64_accum_t operator*(LHS lhs, RHS rhs) \
+{ \
+  return __float64_accum_multiply(lhs, rhs); \
+} \
+
+FLOAT64_ACCUM_OPERATORS(float64_accum_t, float64_accum_t);
+FLOAT64_ACCUM_OPERATORS(float64_accum_t, float64_t);
+FLOAT64_ACCUM_OPERATORS(float64_t, float64_accum_t);
+FLOAT64_ACCUM_OPERATORS(float64_accum_t, float);
+FLOAT64_ACCUM_OPERATORS(float, float64_accum_t);
+
+#undef FLOAT64_ACCUM_OPERATORS
+
+METAL_FUNC thread float64_accum_t &float64_accum_t::operator+=
+ (
+  float64_accum_t rhs)
+{
+  return *this = *this + rhs;
+}
+
+METAL_FUNC thread float64_accum_t &float64_accum_t::operator-=
+ (
+  float64_accum_t rhs)
+{
+  return *this = *this - rhs;
+}
+
+METAL_FUNC thread float64_accum_t &float64_accum_t::operator*=
+ (
+  float64_accum_t rhs)
+{
+  return *this = *this * rhs;
+}
+
+// MARK: - float64_t Operators
+
+// Each operator unpacks, operates in the accumulator format, then rounds
+// once. The results are correctly rounded.
+
+METAL_FUNC float64_t operator-(float64_t x)
+{
+  return __float64(mf64_float64_negate(__core(x)));
+}
+
+METAL_FUNC float64_t operator+(float64_t lhs, float64_t rhs)
+{
+  return __float64(mf64_float64_add(__core(lhs), __core(rhs)));
+}
+
+METAL_FUNC float64_t operator-(float64_t lhs, float64_t rhs)
+{
+  return __float64(mf64_float64_subtract(__core(lhs), __core(rhs)));
+}
+
+METAL_FUNC float64_t operator*(float64_t lhs, float64_t rhs)
+{
+  return __float64(mf64_float64_multiply(__core(lhs), __core(rhs)));
+}
+
+// Mixed operands take the FP64*FP32 path in `float64_accum_t`.
+#define FLOAT64_OPERATORS(LHS, RHS) \
+METAL_FUNC float64_t operator+(LHS lhs, RHS rhs) \
+{ \
+  return float64_t(float64_accum_t(lhs) + rhs); \
+} \
+METAL_FUNC float64_t operator-(LHS lhs, RHS rhs) \
+{ \
+  return float64_t(float64_accum_t(lhs) - rhs); \
+} \
+METAL_FUNC float64_t operator*(LHS lhs, RHS rhs) \
+{ \
+  return float64_t(float64_accum_t(lhs) * rhs); \
+} \
+
+FLOAT64_OPERATORS(float64_t, float);
+FLOAT64_OPERATORS(float, float64_t);
+
+#undef FLOAT64_OPERATORS
+
+METAL_FUNC thread float64_t &operator+=(thread float64_t &lhs, float64_t rhs)
+{
+  return lhs = lhs + rhs;
+}
+
+METAL_FUNC thread float64_t &operator-=(thread float64_t &lhs, float64_t rhs)
+{
+  return lhs = lhs - rhs;
+}
+
+METAL_FUNC thread float64_t &operator*=(thread float64_t &lhs, float64_t rhs)
+{
+  return lhs = lhs * rhs;
+}
+} // namespace metal_float64
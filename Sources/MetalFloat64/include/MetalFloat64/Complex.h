@@ -0,0 +1,258 @@
+// MARK: - Complex.h
+
+namespace metal_float64
+{
+// Complex numbers over `float64_t` or `float32x2_t`, stored as a 2-vector of
+// (real, imaginary).
+//
+// Products stay unrounded until they combine with the next term, so complex
+// multiplication and multiply-add round once per component, instead of after
+// every emulated operation. For `float64_t`, the error before rounding is
+// ~2^-60 relative to the products, so each component is within 1 ulp unless
+// the products cancel.
+template <typename T>
+class complex {
+public:
+  // Must be public as an internal implementation detail, but the user should
+  // never access this property.
+  vec<T, 2> _data;
+
+  DEFAULT_CTORS(complex);
+
+  complex(T real, T imag = T()) thread : _data(real, imag) {}
+
+  complex(vec<T, 2> data) thread : _data(data) {}
+
+  T real() const
+  {
+    return _data._data[0];
+  }
+
+  T imag() const
+  {
+    return _data._data[1];
+  }
+};
+
+typedef complex<float64_t> cdouble;
+
+namespace
+{
+// The format that products are held in before rounding. `float32x2_t`
+// products are not normalized, so `lo` may exceed half an ulp of `hi`.
+template <typename T>
+struct __complex_traits {};
+
+template <>
+struct __complex_traits<float64_t> {
+  using unrounded_type = float64_accum_t;
+};
+
+template <>
+struct __complex_traits<float32x2_t> {
+  using unrounded_type = float32x2_t;
+};
+
+// Computes a * b + c * d without rounding.
+METAL_FUNC float64_accum_t __unrounded_dot2
+ (
+  float64_t a, float64_t b, float64_t c, float64_t d)
+{
+  return float64_accum_t(a) * b + float64_accum_t(c) * d;
+}
+
+METAL_FUNC float32x2_t __unrounded_dot2
+ (
+  float32x2_t a, float32x2_t b, float32x2_t c, float32x2_t d)
+{
+  PRECISE_MATH
+  float2 lhs = __two_prod(a.hi, b.hi);
+  float2 rhs = __two_prod(c.hi, d.hi);
+  float2 sum = __two_sum(lhs[0], rhs[0]);
+  float error = metal::fma(a.lo, b.hi, lhs[1]);
+  error = metal::fma(a.hi, b.lo, error);
+  error = metal::fma(c.lo, d.hi, error + rhs[1]);
+  error = metal::fma(c.hi, d.lo, error);
+  return float32x2_t(sum[0], sum[1] + error);
+}
+
+// Adds two unrounded terms without rounding. For `float32x2_t`, this skips the
+// normalization in `operator+`, leaving it to `__complex_round`.
+METAL_FUNC float64_accum_t __unrounded_add
+ (
+  float64_accum_t lhs, float64_accum_t rhs)
+{
+  return lhs + rhs;
+}
+
+METAL_FUNC float32x2_t __unrounded_add(float32x2_t lhs, float32x2_t rhs)
+{
+  PRECISE_MATH
+  float2 sum = __two_sum(lhs.hi, rhs.hi);
+  return float32x2_t(sum[0], sum[1] + (lhs.lo + rhs.lo));
+}
+
+METAL_FUNC float64_accum_t __unrounded_subtract
+ (
+  float64_accum_t lhs, float64_accum_t rhs)
+{
+  return lhs - rhs;
+}
+
+METAL_FUNC float32x2_t __unrounded_subtract(float32x2_t lhs, float32x2_t rhs)
+{
+  return __unrounded_add(lhs, -rhs);
+}
+
+METAL_FUNC float64_t __complex_round(float64_accum_t x)
+{
+  return float64_t(x);
+}
+
+METAL_FUNC float32x2_t __complex_round(float32x2_t x)
+{
+  return __float32x2_normalize(x.hi, x.lo);
+}
+
+template <typename T>
+struct __complex_unrounded {
+  typename __complex_traits<T>::unrounded_type real;
+  typename __complex_traits<T>::unrounded_type imag;
+};
+
+template <typename T>
+METAL_FUNC __complex_unrounded<T> __complex_multiply
+ (
+  complex<T> lhs, complex<T> rhs)
+{
+  __complex_unrounded<T> output;
+  output.real = __unrounded_dot2(
+    lhs.real(), rhs.real(), -lhs.imag(), rhs.imag());
+  output.imag = __unrounded_dot2(
+    lhs.real(), rhs.imag(), lhs.imag(), rhs.real());
+  return output;
+}
+} // namespace
+
+// MARK: - Arithmetic
+
+template <typename T>
+METAL_FUNC complex<T> operator-(complex<T> x)
+{
+  return complex<T>(-x.real(), -x.imag());
+}
+
+template <typename T>
+METAL_FUNC complex<T> operator+(complex<T> lhs, complex<T> rhs)
+{
+  return complex<T>(lhs.real() + rhs.real(), lhs.imag() + rhs.imag());
+}
+
+template <typename T>
+METAL_FUNC complex<T> operator-(complex<T> lhs, complex<T> rhs)
+{
+  return complex<T>(lhs.real() - rhs.real(), lhs.imag() - rhs.imag());
+}
+
+template <typename T>
+METAL_FUNC complex<T> operator*(complex<T> lhs, complex<T> rhs)
+{
+  __complex_unrounded<T> product = __complex_multiply(lhs, rhs);
+  return complex<T>(
+    __complex_round(product.real), __complex_round(product.imag));
+}
+
+template <typename T>
+METAL_FUNC complex<T> operator*(complex<T> lhs, T rhs)
+{
+  return complex<T>(lhs.real() * rhs, lhs.imag() * rhs);
+}
+
+template <typename T>
+METAL_FUNC complex<T> operator*(T lhs, complex<T> rhs)
+{
+  return rhs * lhs;
+}
+
+// Computes a * b + c, rounding once per component.
+template <typename T>
+METAL_FUNC complex<T> fma(complex<T> a, complex<T> b, complex<T> c)
+{
+  __complex_unrounded<T> product = __complex_multiply(a, b);
+  return complex<T>(
+    __complex_round(__unrounded_add(c.real(), product.real)),
+    __complex_round(__unrounded_add(c.imag(), product.imag)));
+}
+
+template <typename T>
+METAL_FUNC complex<T> conj(complex<T> x)
+{
+  return complex<T>(x.real(), -x.imag());
+}
+
+// The squared magnitude, real^2 + imag^2.
+template <typename T>
+METAL_FUNC T norm(complex<T> x)
+{
+  return __complex_round(
+    __unrounded_dot2(x.real(), x.real(), x.imag(), x.imag()));
+}
+
+// MARK: - FFT Butterflies
+
+// Decimation-in-time butterflies for the forward transform, where the
+// twiddle factors are exp(-2 pi i k / N). For the inverse transform, pass
+// conjugated twiddle factors and scale the result by 1 / N.
+//
+// Each product with a twiddle factor stays unrounded until it is added to
+// another term. That matters most for `float64_t`, where rounding and
+// repacking dominates the cost of every operation.
+
+// (a, b) -> (a + w * b, a - w * b)
+template <typename T>
+METAL_FUNC void fft_butterfly2
+ (
+  thread complex<T> &a, thread complex<T> &b, complex<T> twiddle)
+{
+  __complex_unrounded<T> t = __complex_multiply(twiddle, b);
+  b = complex<T>(
+    __complex_round(__unrounded_subtract(a.real(), t.real)),
+    __complex_round(__unrounded_subtract(a.imag(), t.imag)));
+  a = complex<T>(
+    __complex_round(__unrounded_add(a.real(), t.real)),
+    __complex_round(__unrounded_add(a.imag(), t.imag)));
+}
+
+// A 4-point DFT of (x0, w1 * x1, w2 * x2, w3 * x3), written back in order.
+template <typename T>
+METAL_FUNC void fft_butterfly4
+ (
+  thread complex<T> &x0, thread complex<T> &x1, thread complex<T> &x2,
+  thread complex<T> &x3, complex<T> twiddle1, complex<T> twiddle2,
+  complex<T> twiddle3)
+{
+  __complex_unrounded<T> t1 = __complex_multiply(twiddle1, x1);
+  __complex_unrounded<T> t2 = __complex_multiply(twiddle2, x2);
+  __complex_unrounded<T> t3 = __complex_multiply(twiddle3, x3);
+
+  complex<T> even_sum(
+    __complex_round(__unrounded_add(x0.real(), t2.real)),
+    __complex_round(__unrounded_add(x0.imag(), t2.imag)));
+  complex<T> even_difference(
+    __complex_round(__unrounded_subtract(x0.real(), t2.real)),
+    __complex_round(__unrounded_subtract(x0.imag(), t2.imag)));
+  complex<T> odd_sum(
+    __complex_round(__unrounded_add(t1.real, t3.real)),
+    __complex_round(__unrounded_add(t1.imag, t3.imag)));
+
+  // Multiplying by -i swaps the components, which is exact.
+  complex<T> odd_difference(
+    __complex_round(__unrounded_subtract(t1.imag, t3.imag)),
+    __complex_round(__unrounded_subtract(t3.real, t1.real)));
+
+  x0 = even_sum + odd_sum;
+  x1 = even_difference + odd_difference;
+  x2 = even_sum - odd_sum;
+  x3 = even_difference - odd_difference;
+}
+} // namespace metal_float64
@@ -0,0 +1,344 @@
+// MARK: - Conversion.h
+
+namespace metal_float64
+{
+// Conversions between `float64_t`, `float32x2_t`, `float59_t`, `float43_t`,
+// `float64_accum_t`, and the native `float`, `half`, `int`, and `long`:
+//
+//   float x = convert<float>(y);
+//   long i = convert<long, rounding_mode::truncate>(y);
+//   float32x2_t z = convert<float32x2_t>(y);
+//   double4 w = convert<double>(float4(...));
+//
+// Results are correctly rounded in the chosen mode, so they match native CPU
+// casts bit for bit. A few details:
+// - Integer results saturate when out of range, and NAN becomes 0.
+// - `float32x2_t` results round the upper half, then round the remainder into
+//   the lower half. Values outside the range of `float` are undefined.
+// - Widening conversions are exact, and cost only a few instructions.
+// - Defining METAL_FLOAT64_DISABLE_EDGE_CASES skips INF and NAN handling, like
+//   the arithmetic operators.
+//
+// Each conversion forwards to the `mf64_*` functions in "MetalFloat64Core.h",
+// which the host tests check against CPU casts.
+
+namespace
+{
+// MARK: - Unpacking
+
+// Every input fits in `float64_accum_t` without rounding, except `long` and
+// `float32x2_t` which may exceed 62 bits. Those jam the extra bits into bit 0,
+// which still rounds correctly to any output with 53 bits or fewer.
+
+METAL_FUNC float64_accum_t __convert_unpack(float64_accum_t x)
+{
+  return x;
+}
+
+METAL_FUNC float64_accum_t __convert_unpack(float64_t x)
+{
+  return float64_accum_t(x);
+}
+
+METAL_FUNC float64_accum_t __convert_unpack(float59_t x)
+{
+  float64_t widened;
+  widened.data = x.data;
+  return float64_accum_t(widened);
+}
+
+METAL_FUNC float64_accum_t __convert_unpack(float43_t x)
+{
+  float64_t widened;
+  widened.data = x.data;
+  return float64_accum_t(widened);
+}
+
+METAL_FUNC float64_accum_t __convert_unpack(float32x2_t x)
+{
+  return __float64_accum(mf64_accum_from_float32x2(__core(x)));
+}
+
+METAL_FUNC float64_accum_t __convert_unpack(float x)
+{
+  return float64_accum_t(x);
+}
+
+METAL_FUNC float64_accum_t __convert_unpack(half x)
+{
+  return float64_accum_t(float(x));
+}
+
+METAL_FUNC float64_accum_t __convert_unpack(long x)
+{
+  return __float64_accum(mf64_accum_from_long(x));
+}
+
+METAL_FUNC float64_accum_t __convert_unpack(int x)
+{
+  return __convert_unpack(long(x));
+}
+
+// MARK: - Packing
+
+template <rounding_mode Mode>
+METAL_FUNC long __float64_accum_to_integer
+ (
+  float64_accum_t x, uint magnitude_bits)
+{
+  return mf64_accum_to_integer(
+    __core(x), int(magnitude_bits), mf64_rounding_mode_t(Mode));
+}
+
+template <typename T, rounding_mode Mode>
+struct __convert_pack {};
+
+template <rounding_mode Mode>
+struct __convert_pack<float64_accum_t, Mode> {
+  static METAL_FUNC float64_accum_t apply(float64_accum_t x)
+  {
+    return x;
+  }
+};
+
+template <rounding_mode Mode>
+struct __convert_pack<float64_t, Mode> {
+  static METAL_FUNC float64_t apply(float64_accum_t x)
+  {
+    float64_t output;
+    output.data = __float64_accum_round<11, 52, Mode>(x);
+    return output;
+  }
+};
+
+template <rounding_mode Mode>
+struct __convert_pack<float59_t, Mode> {
+  static METAL_FUNC float59_t apply(float64_accum_t x)
+  {
+    float59_t output;
+    output.data = __float64_accum_round<11, 47, Mode>(x) << 5;
+    return output;
+  }
+};
+
+template <rounding_mode Mode>
+struct __convert_pack<float43_t, Mode> {
+  static METAL_FUNC float43_t apply(float64_accum_t x)
+  {
+    float43_t output;
+    output.data = __float64_accum_round<11, 31, Mode>(x) << 21;
+    return output;
+  }
+};
+
+template <rounding_mode Mode>
+struct __convert_pack<float, Mode> {
+  static METAL_FUNC float apply(float64_accum_t x)
+  {
+    return as_type<float>(uint(__float64_accum_round<8, 23, Mode>(x)));
+  }
+};
+
+template <rounding_mode Mode>
+struct __convert_pack<half, Mode> {
+  static METAL_FUNC half apply(float64_accum_t x)
+  {
+    return as_type<half>(ushort(__float64_accum_round<5, 10, Mode>(x)));
+  }
+};
+
+template <rounding_mode Mode>
+struct __convert_pack<float32x2_t, Mode> {
+  static METAL_FUNC float32x2_t apply(float64_accum_t x)
+  {
+    return __float32x2(
+      mf64_accum_to_float32x2(__core(x), mf64_rounding_mode_t(Mode)));
+  }
+};
+
+template <rounding_mode Mode>
+struct __convert_pack<long, Mode> {
+  static METAL_FUNC long apply(float64_accum_t x)
+  {
+    return __float64_accum_to_integer<Mode>(x, 63);
+  }
+};
+
+template <rounding_mode Mode>
+struct __convert_pack<int, Mode> {
+  static METAL_FUNC int apply(float64_accum_t x)
+  {
+    return int(__float64_accum_to_integer<Mode>(x, 31));
+  }
+};
+
+// MARK: - Fast Paths
+
+// Widens a float to the bit pattern of a `double`. Normal numbers only need
+// their exponent rebiased.
+METAL_FUNC ulong __float_widen_bits(float x)
+{
+  return mf64_float64_from_float(x).data;
+}
+
+// Clears the lowest bits of a `double`'s mantissa, without unpacking.
+template <uint DroppedBits, rounding_mode Mode>
+METAL_FUNC ulong __float64_narrow_bits(ulong bits)
+{
+  return mf64_float64_narrow_bits(
+    bits, int(DroppedBits), mf64_rounding_mode_t(Mode));
+}
+
+// Most conversions unpack to `float64_accum_t`, then round into the output.
+// Specializations skip the unpacked format when a cheaper path exists.
+template <typename T, typename U, rounding_mode Mode>
+struct __converter {
+  static METAL_FUNC T apply(U x)
+  {
+    return __convert_pack<T, Mode>::apply(__convert_unpack(x));
+  }
+};
+
+template <typename T, rounding_mode Mode>
+struct __converter<T, T, Mode> {
+  static METAL_FUNC T apply(T x)
+  {
+    return x;
+  }
+};
+
+#define CONVERT_WIDEN_FLOAT(T) \
+template <rounding_mode Mode> \
+struct __converter<T, float, Mode> { \
+  static METAL_FUNC T apply(float x) \
+  { \
+    T output; \
+    output.data = __float_widen_bits(x); \
+    return output; \
+  } \
+}; \
+
+#define CONVERT_WIDEN(T, U) \
+template <rounding_mode Mode> \
+struct __converter<T, U, Mode> { \
+  static METAL_FUNC T apply(U x) \
+  { \
+    T output; \
+    output.data = x.data; \
+    return output; \
+  } \
+}; \
+
+#define CONVERT_NARROW(T, U, DROPPED_BITS) \
+template <rounding_mode Mode> \
+struct __converter<T, U, Mode> { \
+  static METAL_FUNC T apply(U x) \
+  { \
+    T output; \
+    output.data = __float64_narrow_bits<DROPPED_BITS, Mode>(x.data); \
+    return output; \
+  } \
+}; \
+
+// `float` has 23 bits of fraction, so it also fits `float43_t` exactly.
+CONVERT_WIDEN_FLOAT(float64_t);
+CONVERT_WIDEN_FLOAT(float59_t);
+CONVERT_WIDEN_FLOAT(float43_t);
+
+CONVERT_WIDEN(float64_t, float59_t);
+CONVERT_WIDEN(float64_t, float43_t);
+CONVERT_WIDEN(float59_t, float43_t);
+
+CONVERT_NARROW(float59_t, float64_t, 5);
+CONVERT_NARROW(float43_t, float64_t, 21);
+CONVERT_NARROW(float43_t, float59_t, 21);
+
+#undef CONVERT_NARROW
+#undef CONVERT_WIDEN
+#undef CONVERT_WIDEN_FLOAT
+
+template <rounding_mode Mode>
+struct __converter<float32x2_t, float, Mode> {
+  static METAL_FUNC float32x2_t apply(float x)
+  {
+    return float32x2_t(x, 0);
+  }
+};
+} // namespace
+
+// MARK: - Public Interface
+
+template <
+  typename T, rounding_mode Mode = rounding_mode::nearest, typename U>
+METAL_FUNC T convert(U x)
+{
+  return __converter<T, U, Mode>::apply(x);
+}
+
+// Vectors of 64-bit types, such as `double2`.
+
+template <
+  typename T, rounding_mode Mode = rounding_mode::nearest, typename U>
+METAL_FUNC vec<T, 2> convert(__metal_float64_vec<U, 2> x)
+{
+  return vec<T, 2>(
+    convert<T, Mode>(x._data[0]),
+    convert<T, Mode>(x._data[1]));
+}
+
+template <
+  typename T, rounding_mode Mode = rounding_mode::nearest, typename U>
+METAL_FUNC vec<T, 3> convert(__metal_float64_vec<U, 3> x)
+{
+  return vec<T, 3>(
+    convert<T, Mode>(x._data[0]),
+    convert<T, Mode>(x._data[1]),
+    convert<T, Mode>(x._data[2]));
+}
+
+template <
+  typename T, rounding_mode Mode = rounding_mode::nearest, typename U>
+METAL_FUNC vec<T, 4> convert(__metal_float64_vec<U, 4> x)
+{
+  return vec<T, 4>(
+    convert<T, Mode>(x._data[0]),
+    convert<T, Mode>(x._data[1]),
+    convert<T, Mode>(x._data[2]),
+    convert<T, Mode>(x._data[3]));
+}
+
+// Vectors of native types, such as `float2`.
+
+#define CONVERT_NATIVE_VECTORS(U) \
+template <typename T, rounding_mode Mode = rounding_mode::nearest> \
+METAL_FUNC vec<T, 2> convert(U##2 x) \
+{ \
+  return vec<T, 2>( \
+    convert<T, Mode>(x[0]), \
+    convert<T, Mode>(x[1])); \
+} \
+template <typename T, rounding_mode Mode = rounding_mode::nearest> \
+METAL_FUNC vec<T, 3> convert(U##3 x) \
+{ \
+  return vec<T, 3>( \
+    convert<T, Mode>(x[0]), \
+    convert<T, Mode>(x[1]), \
+    convert<T, Mode>(x[2])); \
+} \
+template <typename T, rounding_mode Mode = rounding_mode::nearest> \
+METAL_FUNC vec<T, 4> convert(U##4 x) \
+{ \
+  return vec<T, 4>( \
+    convert<T, Mode>(x[0]), \
+    convert<T, Mode>(x[1]), \
+    convert<T, Mode>(x[2]), \
+    convert<T, Mode>(x[3])); \
+} \
+
+CONVERT_NATIVE_VECTORS(float);
+CONVERT_NATIVE_VECTORS(half);
+CONVERT_NATIVE_VECTORS(int);
+CONVERT_NATIVE_VECTORS(long);
+
+#undef CONVERT_NATIVE_VECTORS
+} // namespace metal_float64
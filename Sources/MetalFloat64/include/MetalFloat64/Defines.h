@@ -11,3 +11,24 @@
 // Apply this to force-inline functions internally.
 // The Metal Standard Library uses it, so it should work reliably.
 #define ALWAYS_INLINE __attribute__((__always_inline__))
+
+// Place at the start of a function body whose floating-point operations must
+// happen exactly as written. Metal compiles with fast math by default, which
+// would otherwise simplify error-free transformations like `(a + b) - a`.
+#define PRECISE_MATH _Pragma("clang fp reassociate(off)")
+
+// Apply this to classes with user-declared constructors, so they stay
+// default-constructible in every address space.
+#define DEFAULT_CTORS(TYPE) \
+TYPE() thread = default; \
+TYPE() device = default; \
+TYPE() constant = default; \
+TYPE() threadgroup = default; \
+TYPE() threadgroup_imageblock = default; \
+TYPE() ray_data = default; \
+TYPE() object_data = default; \
+
+// Define this before including the header to skip INF and NAN handling in
+// `float64_t` math. This is the "eFP64" mode from the README. Denormals are
+// still preserved, but INF, NAN, and overflowing results become undefined.
+// #define METAL_FLOAT64_DISABLE_EDGE_CASES
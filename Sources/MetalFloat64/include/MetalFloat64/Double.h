@@ -5,15 +5,78 @@
 
 namespace metal_float64
 {
+// Arithmetic operators are defined in "Accumulator.h", on top of the unpacked
+// format that `float64_accum_t` uses.
 class float64_t {
+public:
+  // Must be public as an internal implementation detail, but the user should
+  // never access this property.
   ulong data;
 };
 
+// Double-single approach: the unevaluated sum of two floats, where `lo` is at
+// most half an ulp of `hi`. Arithmetic operators are defined in "Float32x2.h".
+class float32x2_t {
+public:
+  // Must be public as an internal implementation detail, but the user should
+  // never access these properties.
+  float hi;
+  float lo;
+  
+  DEFAULT_CTORS(float32x2_t);
+  
+  constexpr float32x2_t(float hi, float lo = 0) thread : hi(hi), lo(lo) {}
+  constexpr float32x2_t(float hi, float lo = 0) constant : hi(hi), lo(lo) {}
+};
+
+// Reduced-precision formats with the same range as `float64_t`. They share its
+// memory layout, but the lowest 5 (`float59_t`) or 21 (`float43_t`) bits of
+// the mantissa are always zero. That leaves 1+47 and 1+31 bits of mantissa.
+// Converting to `float64_t` or to a more precise format is exact.
 class float59_t {
+public:
+  // Must be public as an internal implementation detail, but the user should
+  // never access this property.
   ulong data;
 };
 
 class float43_t {
+public:
+  // Must be public as an internal implementation detail, but the user should
+  // never access this property.
   ulong data;
 };
+
+namespace
+{
+// The arithmetic lives in "MetalFloat64Core.h", whose C structs share their
+// layouts with the classes above. These conversions only copy fields, so they
+// compile away.
+METAL_FUNC mf64_float64_t __core(float64_t x)
+{
+  mf64_float64_t output;
+  output.data = x.data;
+  return output;
+}
+
+METAL_FUNC mf64_float32x2_t __core(float32x2_t x)
+{
+  mf64_float32x2_t output;
+  output.hi = x.hi;
+  output.lo = x.lo;
+  return output;
+}
+
+METAL_FUNC float64_t __float64(mf64_float64_t x)
+{
+  float64_t output;
+  output.data = x.data;
+  return output;
+}
+
+METAL_FUNC float32x2_t __float32x2(mf64_float32x2_t x)
+{
+  return float32x2_t(x.hi, x.lo);
+}
+} // namespace
 } // namespace metal_float64
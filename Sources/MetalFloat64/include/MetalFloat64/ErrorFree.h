@@ -0,0 +1,191 @@
+// MARK: - ErrorFree.h
+
+namespace metal_float64
+{
+// Error-free transformations, the building blocks for compensated summation,
+// double-double (quad precision) arithmetic, and exact dot products. Each one
+// returns the rounded result and writes the rounding error to its last
+// argument. The error is exact, so result + error equals the exact value:
+//
+//   float64_t error;
+//   float64_t sum = two_sum(a, b, error); // sum + error == a + b
+//
+// Both versions forward to the `mf64_*` functions in "MetalFloat64Core.h", so
+// they match the host build bit for bit. They match IEEE `double` except
+// possibly in the sign of a zero error.
+//
+// Inputs must be finite and results must not overflow. `two_prod` is also
+// only exact when the error does not underflow. `split` accepts any finite
+// input, but near the largest finite number, where rounding `hi` up would
+// overflow, it truncates instead. That starts at (2 - 2^-12) * 2^127 for
+// `float`, where both halves still fit in 12 bits, and at (2 - 2^-26) * 2^1023
+// for `float64_t`, where `lo` may need 27 bits.
+
+// MARK: - float
+
+// Requires |a| >= |b|, or a == 0.
+METAL_FUNC float fast_two_sum(float a, float b, thread float &error)
+{
+  mf64_float32x2_t output = mf64_fast_two_sum(a, b);
+  error = output.lo;
+  return output.hi;
+}
+
+METAL_FUNC float two_sum(float a, float b, thread float &error)
+{
+  mf64_float32x2_t output = mf64_two_sum(a, b);
+  error = output.lo;
+  return output.hi;
+}
+
+METAL_FUNC float two_prod(float a, float b, thread float &error)
+{
+  mf64_float32x2_t output = mf64_two_prod(a, b);
+  error = output.lo;
+  return output.hi;
+}
+
+// Rounds to 12 significant bits, and returns the remainder in `lo`. Both
+// halves fit in 12 bits, so products between them are exact.
+METAL_FUNC float split(float x, thread float &lo)
+{
+  mf64_float32x2_t output = mf64_split(x);
+  lo = output.lo;
+  return output.hi;
+}
+
+// Vectors of `float`. Apple GPUs are scalar, so operating on one element at a
+// time costs nothing extra.
+
+#define ERROR_FREE_FLOAT(T, N) \
+METAL_FUNC T fast_two_sum(T a, T b, thread T &error) \
+{ \
+  T output; \
+  for (uint i = 0; i < N; ++i) { \
+    float element_error; \
+    output[i] = fast_two_sum(a[i], b[i], element_error); \
+    error[i] = element_error; \
+  } \
+  return output; \
+} \
+\
+METAL_FUNC T two_sum(T a, T b, thread T &error) \
+{ \
+  T output; \
+  for (uint i = 0; i < N; ++i) { \
+    float element_error; \
+    output[i] = two_sum(a[i], b[i], element_error); \
+    error[i] = element_error; \
+  } \
+  return output; \
+} \
+\
+METAL_FUNC T two_prod(T a, T b, thread T &error) \
+{ \
+  T output; \
+  for (uint i = 0; i < N; ++i) { \
+    float element_error; \
+    output[i] = two_prod(a[i], b[i], element_error); \
+    error[i] = element_error; \
+  } \
+  return output; \
+} \
+\
+METAL_FUNC T split(T x, thread T &lo) \
+{ \
+  T hi; \
+  for (uint i = 0; i < N; ++i) { \
+    float element_lo; \
+    hi[i] = split(x[i], element_lo); \
+    lo[i] = element_lo; \
+  } \
+  return hi; \
+} \
+
+ERROR_FREE_FLOAT(float2, 2);
+ERROR_FREE_FLOAT(float3, 3);
+ERROR_FREE_FLOAT(float4, 4);
+
+#undef ERROR_FREE_FLOAT
+
+// MARK: - float64_t
+
+// Requires |a| >= |b|, or a == 0.
+METAL_FUNC float64_t fast_two_sum
+ (
+  float64_t a, float64_t b, thread float64_t &error)
+{
+  mf64_float64x2_t output = mf64_float64_fast_two_sum(__core(a), __core(b));
+  error = __float64(output.lo);
+  return __float64(output.hi);
+}
+
+// Orders the operands by magnitude, then calls `fast_two_sum`. Comparing bit
+// patterns without the sign is cheaper than the 6-operation branchless
+// algorithm, which would repack after every step.
+METAL_FUNC float64_t two_sum
+ (
+  float64_t a, float64_t b, thread float64_t &error)
+{
+  mf64_float64x2_t output = mf64_float64_two_sum(__core(a), __core(b));
+  error = __float64(output.lo);
+  return __float64(output.hi);
+}
+
+// Rounds to 26 significant bits, and returns the remainder in `lo`. Both
+// halves fit in 26 bits, so products between them are exact.
+METAL_FUNC float64_t split(float64_t x, thread float64_t &lo)
+{
+  mf64_float64x2_t output = mf64_float64_split(__core(x));
+  lo = __float64(output.lo);
+  return __float64(output.hi);
+}
+
+// Dekker's product, with the operands split in the accumulator format. Every
+// partial product and partial sum is exactly representable, and the format
+// never overflows or underflows, so the only rounding happens when converting
+// the error.
+METAL_FUNC float64_t two_prod
+ (
+  float64_t a, float64_t b, thread float64_t &error)
+{
+  mf64_float64x2_t output = mf64_float64_two_prod(__core(a), __core(b));
+  error = __float64(output.lo);
+  return __float64(output.hi);
+}
+
+// Vectors of `float64_t`, such as `double2`.
+
+#define ERROR_FREE_VECTOR(NAME) \
+template <uint N> \
+METAL_FUNC __metal_float64_vec<float64_t, N> NAME \
+ ( \
+  __metal_float64_vec<float64_t, N> a, __metal_float64_vec<float64_t, N> b, \
+  thread __metal_float64_vec<float64_t, N> &error) \
+{ \
+  __metal_float64_vec<float64_t, N> output; \
+  for (uint i = 0; i < N; ++i) { \
+    output._data[i] = NAME(a._data[i], b._data[i], error._data[i]); \
+  } \
+  return output; \
+} \
+
+ERROR_FREE_VECTOR(fast_two_sum);
+ERROR_FREE_VECTOR(two_sum);
+ERROR_FREE_VECTOR(two_prod);
+
+#undef ERROR_FREE_VECTOR
+
+template <uint N>
+METAL_FUNC __metal_float64_vec<float64_t, N> split
+ (
+  __metal_float64_vec<float64_t, N> x,
+  thread __metal_float64_vec<float64_t, N> &lo)
+{
+  __metal_float64_vec<float64_t, N> hi;
+  for (uint i = 0; i < N; ++i) {
+    hi._data[i] = split(x._data[i], lo._data[i]);
+  }
+  return hi;
+}
+} // namespace metal_float64
@@ -0,0 +1,201 @@
+// MARK: - Float32x2.h
+
+namespace metal_float64
+{
+// Error-free transformations, which the double-single operators build on.
+// Each returns (result, error), where the error is exact.
+namespace
+{
+METAL_FUNC float2 __float2(mf64_float32x2_t x)
+{
+  return float2(x.hi, x.lo);
+}
+
+// Requires |a| >= |b|, or a == 0.
+METAL_FUNC float2 __fast_two_sum(float a, float b)
+{
+  return __float2(mf64_fast_two_sum(a, b));
+}
+
+METAL_FUNC float2 __two_sum(float a, float b)
+{
+  return __float2(mf64_two_sum(a, b));
+}
+
+METAL_FUNC float2 __two_prod(float a, float b)
+{
+  return __float2(mf64_two_prod(a, b));
+}
+
+// The "FP64.normalized()" step from the README's cost notes.
+METAL_FUNC float32x2_t __float32x2_normalize(float hi, float lo)
+{
+  return __float32x2(mf64_fast_two_sum(hi, lo));
+}
+} // namespace
+
+METAL_FUNC float32x2_t operator-(float32x2_t x)
+{
+  return __float32x2(mf64_float32x2_negate(__core(x)));
+}
+
+// MARK: - Addition
+
+// FP64+FP64=FP64 - 11 instructions
+METAL_FUNC float32x2_t operator+(float32x2_t lhs, float32x2_t rhs)
+{
+  return __float32x2(mf64_float32x2_add(__core(lhs), __core(rhs)));
+}
+
+// FP64+FP32=FP64 - 10 instructions
+METAL_FUNC float32x2_t operator+(float32x2_t lhs, float rhs)
+{
+  return __float32x2(mf64_float32x2_add_float(__core(lhs), rhs));
+}
+
+METAL_FUNC float32x2_t operator+(float lhs, float32x2_t rhs)
+{
+  return rhs + lhs;
+}
+
+METAL_FUNC float32x2_t operator-(float32x2_t lhs, float32x2_t rhs)
+{
+  return lhs + -rhs;
+}
+
+METAL_FUNC float32x2_t operator-(float32x2_t lhs, float rhs)
+{
+  return lhs + -rhs;
+}
+
+METAL_FUNC float32x2_t operator-(float lhs, float32x2_t rhs)
+{
+  return -rhs + lhs;
+}
+
+namespace
+{
+// IEEE-style addition, which also tracks the rounding error of the lower
+// halves. Unlike the operators above, it stays accurate when the inputs
+// cancel, at roughly twice the cost.
+METAL_FUNC float32x2_t __float32x2_accurate_add
+ (
+  float32x2_t lhs, float32x2_t rhs)
+{
+  return __float32x2(mf64_float32x2_accurate_add(__core(lhs), __core(rhs)));
+}
+} // namespace
+
+// MARK: - Multiplication
+
+// FP64*FP64=FP64 - 7 instructions
+METAL_FUNC float32x2_t operator*(float32x2_t lhs, float32x2_t rhs)
+{
+  return __float32x2(mf64_float32x2_multiply(__core(lhs), __core(rhs)));
+}
+
+// FP64*FP32=FP64 - 6 instructions
+METAL_FUNC float32x2_t operator*(float32x2_t lhs, float rhs)
+{
+  return __float32x2(mf64_float32x2_multiply_float(__core(lhs), rhs));
+}
+
+METAL_FUNC float32x2_t operator*(float lhs, float32x2_t rhs)
+{
+  return rhs * lhs;
+}
+
+// MARK: - Fused Multiply-Add
+
+// Computes a * b + c, normalizing once instead of twice.
+METAL_FUNC float32x2_t fma(float32x2_t a, float32x2_t b, float32x2_t c)
+{
+  return __float32x2(mf64_float32x2_fma(__core(a), __core(b), __core(c)));
+}
+
+METAL_FUNC float32x2_t fma(float32x2_t a, float32x2_t b, float c)
+{
+  return __float32x2(mf64_float32x2_fma_float(__core(a), __core(b), c));
+}
+
+METAL_FUNC float32x2_t fma(float32x2_t a, float b, float c)
+{
+  return __float32x2(mf64_float32x2_fma_float_float(__core(a), b, c));
+}
+
+// MARK: - Compound Assignment
+
+#define FLOAT32X2_COMPOUND_OPERATORS(RHS) \
+METAL_FUNC thread float32x2_t &operator+=(thread float32x2_t &lhs, RHS rhs) \
+{ \
+  return lhs = lhs + rhs; \
+} \
+METAL_FUNC thread float32x2_t &operator-=(thread float32x2_t &lhs, RHS rhs) \
+{ \
+  return lhs = lhs - rhs; \
+} \
+METAL_FUNC thread float32x2_t &operator*=(thread float32x2_t &lhs, RHS rhs) \
+{ \
+  return lhs = lhs * rhs; \
+} \
+
+FLOAT32X2_COMPOUND_OPERATORS(float32x2_t);
+FLOAT32X2_COMPOUND_OPERATORS(float);
+
+#undef FLOAT32X2_COMPOUND_OPERATORS
+
+// MARK: - Compile-Time Constants
+
+namespace
+{
+constexpr float __constexpr_exp2(int exponent)
+{
+  float output = 1;
+  for (; exponent > 0; --exponent) {
+    output *= 2;
+  }
+  for (; exponent < 0; ++exponent) {
+    output *= 0.5f;
+  }
+  return output;
+}
+} // namespace
+
+// Splits an IEEE double, given by its bit pattern, into the nearest
+// `float32x2_t`. MSL does not support double literals, so use this to build
+// coefficient tables at compile time:
+//
+//   constant float32x2_t coefficients[3] = {
+//     float32x2_split(0x3FF0000000000000), // 1.0
+//     float32x2_split(0x3FB999999999999A), // 0.1
+//     float32x2_split(0x3F847AE147AE147B), // 0.01
+//   };
+//
+// The input must lie within the range of normal floats.
+constexpr float32x2_t float32x2_split(ulong bits)
+{
+  int biased_exponent = int((bits >> 52) & 0x7FF);
+  ulong significand = (bits & 0x000FFFFFFFFFFFFFul) | (ulong(1) << 52);
+
+  // Round the upper 24 bits to nearest even, then keep the remainder (at most
+  // 29 bits, rounded to 24) as the lower half.
+  ulong hi_bits = significand >> 29;
+  ulong remainder = significand & ((ulong(1) << 29) - 1);
+  ulong halfway = ulong(1) << 28;
+  if (remainder > halfway || (remainder == halfway && (hi_bits & 1))) {
+    hi_bits += 1;
+  }
+  long lo_bits = long(significand) - long(hi_bits << 29);
+
+  // Scale the lower half in two steps, so 2^(exponent - 1075) cannot
+  // underflow when the upper half is a small normal.
+  float scale = __constexpr_exp2(biased_exponent - 1046);
+  float hi = float(hi_bits) * scale;
+  float lo = float(lo_bits) * __constexpr_exp2(-29) * scale;
+  if (bits >> 63) {
+    return float32x2_t(-hi, -lo);
+  } else {
+    return float32x2_t(hi, lo);
+  }
+}
+} // namespace metal_float64
@@ -18,9 +18,20 @@
 
 // Single-file header for MetalFloat64 (auto-generated).
 
+// The arithmetic core stays a separate header, shared with OpenCL and the CPU.
+// The merge step only inlines includes with quotation marks.
+#include <MetalFloat64Core/MetalFloat64Core.h>
+
 #include "Defines.h"
 #include "Double.h"
+#include "Accumulator.h"
+#include "Float32x2.h"
 #include "Vector.h"
+#include "ErrorFree.h"
+#include "Conversion.h"
+#include "Polynomial.h"
+#include "Reduction.h"
+#include "Complex.h"
 #include "Atomic.h"
 
 using namespace metal_float64;
@@ -0,0 +1,127 @@
+// MARK: - Polynomial.h
+
+namespace metal_float64
+{
+// Schemes for evaluating c[0] + c[1] * x + ... + c[Degree] * x^Degree.
+//
+// Horner's scheme uses the fewest operations, but every step depends on the
+// previous one. Estrin's scheme evaluates pairs of terms independently, which
+// exposes more instruction-level parallelism at the cost of computing x^2,
+// x^4, etc. Prefer Estrin's scheme for degrees above ~6.
+enum class polynomial_scheme {
+  horner,
+  estrin
+};
+
+namespace
+{
+// The precision that intermediate results are held in. `float64_t` evaluates
+// the entire polynomial in the unpacked format, rounding only once at the end.
+template <typename T>
+struct __polynomial_traits {};
+
+template <>
+struct __polynomial_traits<float64_t> {
+  using accum_type = float64_accum_t;
+};
+
+template <>
+struct __polynomial_traits<float32x2_t> {
+  using accum_type = float32x2_t;
+};
+
+// Computes a * b + c. Dispatches to the mixed-precision paths whenever `b` or
+// `c` is a single-precision coefficient.
+template <typename B, typename C>
+METAL_FUNC float64_accum_t __polynomial_fma(float64_accum_t a, B b, C c)
+{
+  return a * b + c;
+}
+
+template <typename B, typename C>
+METAL_FUNC float32x2_t __polynomial_fma(float32x2_t a, B b, C c)
+{
+  return fma(a, b, c);
+}
+
+template <uint Degree, typename T, typename C>
+METAL_FUNC T __polyval_horner(T x, constant C *coefficients)
+{
+  T output = T(coefficients[Degree]);
+  for (int i = int(Degree) - 1; i >= 0; --i) {
+    output = __polynomial_fma(output, x, coefficients[i]);
+  }
+  return output;
+}
+
+template <uint Degree, typename T, typename C>
+METAL_FUNC T __polyval_estrin(T x, constant C *coefficients)
+{
+  // Leaves are (c[2i] + c[2i + 1] * x), which only multiply by coefficients.
+  T terms[(Degree + 2) / 2];
+  for (uint i = 0; i < (Degree + 1) / 2; ++i) {
+    C c0 = coefficients[2 * i];
+    C c1 = coefficients[2 * i + 1];
+    terms[i] = __polynomial_fma(x, c1, c0);
+  }
+  if (Degree % 2 == 0) {
+    terms[Degree / 2] = T(coefficients[Degree]);
+  }
+
+  // Combine adjacent terms in place, squaring the power every level.
+  T power = x;
+  for (uint count = (Degree + 2) / 2; count > 1; count = (count + 1) / 2) {
+    power = power * power;
+    for (uint i = 0; i < count / 2; ++i) {
+      terms[i] = __polynomial_fma(terms[2 * i + 1], power, terms[2 * i]);
+    }
+    if (count % 2 == 1) {
+      terms[count / 2] = terms[count - 1];
+    }
+  }
+  return terms[0];
+}
+} // namespace
+
+// Evaluates a polynomial with `Degree + 1` coefficients, ordered from the
+// constant term upward. Coefficients may be stored in the same type as `x`, or
+// as `float` to use the cheaper mixed-precision paths. To build a table at
+// compile time, see `float32x2_split` or initialize `float64_t` from its bit
+// pattern:
+//
+//   constant float64_t coefficients[3] = {
+//     { 0x3FF0000000000000 }, // 1.0
+//     { 0x3FE0000000000000 }, // 0.5
+//     { 0x3FC5555555555555 }, // 1/6
+//   };
+//   double y = polyval<2>(x, coefficients);
+template <
+  uint Degree,
+  polynomial_scheme Scheme = polynomial_scheme::horner,
+  typename T, typename C>
+METAL_FUNC T polyval(T x, constant C *coefficients)
+{
+  using accum_type = typename __polynomial_traits<T>::accum_type;
+  accum_type x_accum = accum_type(x);
+  if (Scheme == polynomial_scheme::estrin) {
+    return T(__polyval_estrin<Degree>(x_accum, coefficients));
+  } else {
+    return T(__polyval_horner<Degree>(x_accum, coefficients));
+  }
+}
+
+template <
+  uint Degree,
+  polynomial_scheme Scheme = polynomial_scheme::horner,
+  typename T, uint N, typename C>
+METAL_FUNC __metal_float64_vec<T, N> polyval
+ (
+  __metal_float64_vec<T, N> x, constant C *coefficients)
+{
+  __metal_float64_vec<T, N> output;
+  for (uint i = 0; i < N; ++i) {
+    output._data[i] = polyval<Degree, Scheme>(x._data[i], coefficients);
+  }
+  return output;
+}
+} // namespace metal_float64
@@ -0,0 +1,380 @@
+// MARK: - Reduction.h
+
+namespace metal_float64
+{
+// SIMD-group and threadgroup sums, mirroring `simd_sum` and
+// `simd_prefix_exclusive_sum` from the Metal Standard Library. Shuffles move
+// the two 32-bit halves separately, then the lanes combine with the emulated
+// addition. Summing on-chip first means only one thread per threadgroup needs
+// a 64-bit atomic, instead of every thread.
+//
+// Each sum has a `_compensated` variant, which tracks rounding errors
+// separately:
+// - `float64_t` carries an error term alongside the sum (Kahan-style), adding
+//   it back only at the end. Each step costs several emulated additions.
+// - `float32x2_t` switches to IEEE-style addition, which stays accurate when
+//   terms cancel.
+//
+// Requirements:
+// - Every lane in the SIMD-group must be active. For threadgroup functions,
+//   the threadgroup size must be a multiple of 32.
+// - Every thread in the threadgroup must call the threadgroup functions,
+//   which contain barriers.
+// - `scratch` needs one element per SIMD-group. The `float64_t`
+//   `_compensated` variants need two, keeping error terms in the second half.
+//   The `float32x2_t` ones only need one. `scratch` may be reused as soon as
+//   the function returns.
+//
+// The order of additions is fixed, so the results are deterministic. Every
+// lane receives the same `simd_sum`.
+
+namespace
+{
+// Apple GPUs always have 32 threads per SIMD-group.
+constant ushort __simd_width = 32;
+
+// MARK: - Compensated Types
+
+struct __float64_compensated_t {
+  float64_t sum;
+  float64_t error;
+
+  __float64_compensated_t() = default;
+
+  __float64_compensated_t(float64_t x) : sum(x), error{0} {}
+
+  operator float64_t() const
+  {
+    return sum + error;
+  }
+};
+
+struct __float32x2_compensated_t {
+  float32x2_t value;
+
+  __float32x2_compensated_t() = default;
+
+  __float32x2_compensated_t(float32x2_t x) : value(x) {}
+
+  operator float32x2_t() const
+  {
+    return value;
+  }
+};
+
+// MARK: - Shuffles
+
+METAL_FUNC ulong __simd_shuffle_xor(ulong x, ushort mask)
+{
+  uint2 words = as_type<uint2>(x);
+  words[0] = metal::simd_shuffle_xor(words[0], mask);
+  words[1] = metal::simd_shuffle_xor(words[1], mask);
+  return as_type<ulong>(words);
+}
+
+METAL_FUNC ulong __simd_shuffle_up(ulong x, ushort delta)
+{
+  uint2 words = as_type<uint2>(x);
+  words[0] = metal::simd_shuffle_up(words[0], delta);
+  words[1] = metal::simd_shuffle_up(words[1], delta);
+  return as_type<ulong>(words);
+}
+
+METAL_FUNC ulong __simd_shuffle(ulong x, ushort lane)
+{
+  uint2 words = as_type<uint2>(x);
+  words[0] = metal::simd_shuffle(words[0], lane);
+  words[1] = metal::simd_shuffle(words[1], lane);
+  return as_type<ulong>(words);
+}
+
+METAL_FUNC float64_t __simd_shuffle_xor(float64_t x, ushort mask)
+{
+  x.data = __simd_shuffle_xor(x.data, mask);
+  return x;
+}
+
+METAL_FUNC float64_t __simd_shuffle_up(float64_t x, ushort delta)
+{
+  x.data = __simd_shuffle_up(x.data, delta);
+  return x;
+}
+
+METAL_FUNC float64_t __simd_shuffle(float64_t x, ushort lane)
+{
+  x.data = __simd_shuffle(x.data, lane);
+  return x;
+}
+
+METAL_FUNC float32x2_t __simd_shuffle_xor(float32x2_t x, ushort mask)
+{
+  x.hi = metal::simd_shuffle_xor(x.hi, mask);
+  x.lo = metal::simd_shuffle_xor(x.lo, mask);
+  return x;
+}
+
+METAL_FUNC float32x2_t __simd_shuffle_up(float32x2_t x, ushort delta)
+{
+  x.hi = metal::simd_shuffle_up(x.hi, delta);
+  x.lo = metal::simd_shuffle_up(x.lo, delta);
+  return x;
+}
+
+METAL_FUNC float32x2_t __simd_shuffle(float32x2_t x, ushort lane)
+{
+  x.hi = metal::simd_shuffle(x.hi, lane);
+  x.lo = metal::simd_shuffle(x.lo, lane);
+  return x;
+}
+
+#define COMPENSATED_SHUFFLE(SHUFFLE) \
+METAL_FUNC __float64_compensated_t SHUFFLE \
+ ( \
+  __float64_compensated_t x, ushort argument) \
+{ \
+  x.sum = SHUFFLE(x.sum, argument); \
+  x.error = SHUFFLE(x.error, argument); \
+  return x; \
+} \
+METAL_FUNC __float32x2_compensated_t SHUFFLE \
+ ( \
+  __float32x2_compensated_t x, ushort argument) \
+{ \
+  x.value = SHUFFLE(x.value, argument); \
+  return x; \
+} \
+
+COMPENSATED_SHUFFLE(__simd_shuffle_xor);
+COMPENSATED_SHUFFLE(__simd_shuffle_up);
+COMPENSATED_SHUFFLE(__simd_shuffle);
+
+#undef COMPENSATED_SHUFFLE
+
+// MARK: - Addition
+
+METAL_FUNC float64_t __reduction_add(float64_t lhs, float64_t rhs)
+{
+  return lhs + rhs;
+}
+
+METAL_FUNC float32x2_t __reduction_add(float32x2_t lhs, float32x2_t rhs)
+{
+  return lhs + rhs;
+}
+
+// Fast2Sum recovers the exact rounding error, because `float64_t` addition is
+// correctly rounded. Summing both error terms first keeps the operation
+// commutative, so every lane of a butterfly computes the same result.
+METAL_FUNC __float64_compensated_t __reduction_add
+ (
+  __float64_compensated_t lhs, __float64_compensated_t rhs)
+{
+  float64_t larger = lhs.sum;
+  float64_t smaller = rhs.sum;
+  if ((larger.data << 1) < (smaller.data << 1)) {
+    larger = rhs.sum;
+    smaller = lhs.sum;
+  }
+
+  __float64_compensated_t output;
+  output.sum = larger + smaller;
+  float64_t rounding_error = smaller - (output.sum - larger);
+  output.error = rounding_error + (lhs.error + rhs.error);
+  return output;
+}
+
+METAL_FUNC __float32x2_compensated_t __reduction_add
+ (
+  __float32x2_compensated_t lhs, __float32x2_compensated_t rhs)
+{
+  return __float32x2_accurate_add(lhs.value, rhs.value);
+}
+
+// MARK: - Scratch Memory
+
+// Compensated sums keep their error terms in the second half of `scratch`, so
+// nothing is rounded between the SIMD-group and threadgroup steps.
+template <typename T>
+METAL_FUNC void __scratch_store
+ (
+  threadgroup T *scratch, ushort index, ushort count, T x)
+{
+  scratch[index] = x;
+}
+
+METAL_FUNC void __scratch_store
+ (
+  threadgroup float64_t *scratch, ushort index, ushort count,
+  __float64_compensated_t x)
+{
+  scratch[index] = x.sum;
+  scratch[count + index] = x.error;
+}
+
+METAL_FUNC void __scratch_store
+ (
+  threadgroup float32x2_t *scratch, ushort index, ushort count,
+  __float32x2_compensated_t x)
+{
+  scratch[index] = x.value;
+}
+
+template <typename V, typename T>
+METAL_FUNC V __scratch_load_as
+ (
+  threadgroup T *scratch, ushort index, ushort count)
+{
+  return V(scratch[index]);
+}
+
+template <>
+METAL_FUNC __float64_compensated_t __scratch_load_as
+ (
+  threadgroup float64_t *scratch, ushort index, ushort count)
+{
+  __float64_compensated_t output;
+  output.sum = scratch[index];
+  output.error = scratch[count + index];
+  return output;
+}
+
+// MARK: - Algorithms
+
+// Butterfly reduction, which leaves the total in every lane.
+template <typename V>
+METAL_FUNC V __simd_reduce(V x)
+{
+  for (ushort mask = 1; mask < __simd_width; mask *= 2) {
+    x = __reduction_add(x, __simd_shuffle_xor(x, mask));
+  }
+  return x;
+}
+
+// Hillis-Steele scan. Lower lanes always appear on the left-hand side.
+template <typename V>
+METAL_FUNC V __simd_prefix_inclusive(V x, ushort lane)
+{
+  for (ushort delta = 1; delta < __simd_width; delta *= 2) {
+    V lower = __simd_shuffle_up(x, delta);
+    if (lane >= delta) {
+      x = __reduction_add(lower, x);
+    }
+  }
+  return x;
+}
+
+template <typename V>
+METAL_FUNC V __simd_prefix_exclusive(V x, ushort lane)
+{
+  V inclusive = __simd_prefix_inclusive(x, lane);
+  V shifted = __simd_shuffle_up(inclusive, 1);
+  return (lane == 0) ? V() : shifted;
+}
+
+METAL_FUNC ushort __simd_lane_id()
+{
+  return metal::simd_prefix_exclusive_sum(ushort(1));
+}
+
+// Reduces each SIMD-group, then has every SIMD-group reduce the partial sums.
+template <typename V, typename T>
+METAL_FUNC T __threadgroup_reduce
+ (
+  T x, threadgroup T *scratch, ushort lane, ushort simdgroup_index,
+  ushort simdgroups)
+{
+  V partial = __simd_reduce(V(x));
+  if (lane == 0) {
+    __scratch_store(scratch, simdgroup_index, simdgroups, partial);
+  }
+  metal::threadgroup_barrier(metal::mem_flags::mem_threadgroup);
+
+  V total = V();
+  if (lane < simdgroups) {
+    total = __scratch_load_as<V>(scratch, lane, simdgroups);
+  }
+  total = __simd_reduce(total);
+  metal::threadgroup_barrier(metal::mem_flags::mem_threadgroup);
+  return T(total);
+}
+
+// Scans each SIMD-group, then offsets it by the sum of all previous
+// SIMD-groups.
+template <typename V, typename T>
+METAL_FUNC T __threadgroup_prefix
+ (
+  T x, threadgroup T *scratch, ushort lane, ushort simdgroup_index,
+  ushort simdgroups, bool inclusive)
+{
+  V prefix = __simd_prefix_inclusive(V(x), lane);
+  if (lane == __simd_width - 1) {
+    __scratch_store(scratch, simdgroup_index, simdgroups, prefix);
+  }
+  metal::threadgroup_barrier(metal::mem_flags::mem_threadgroup);
+
+  V offsets = V();
+  if (lane < simdgroups) {
+    offsets = __scratch_load_as<V>(scratch, lane, simdgroups);
+  }
+  offsets = __simd_prefix_exclusive(offsets, lane);
+  V offset = __simd_shuffle(offsets, simdgroup_index);
+  metal::threadgroup_barrier(metal::mem_flags::mem_threadgroup);
+
+  if (!inclusive) {
+    V shifted = __simd_shuffle_up(prefix, 1);
+    prefix = (lane == 0) ? V() : shifted;
+  }
+  return T(__reduction_add(offset, prefix));
+}
+} // namespace
+
+// MARK: - Public Interface
+
+#define SIMD_REDUCTIONS(T, SUFFIX, V) \
+METAL_FUNC T simd_sum##SUFFIX(T x) \
+{ \
+  return T(__simd_reduce(V(x))); \
+} \
+METAL_FUNC T simd_prefix_inclusive_sum##SUFFIX(T x) \
+{ \
+  return T(__simd_prefix_inclusive(V(x), __simd_lane_id())); \
+} \
+METAL_FUNC T simd_prefix_exclusive_sum##SUFFIX(T x) \
+{ \
+  return T(__simd_prefix_exclusive(V(x), __simd_lane_id())); \
+} \
+METAL_FUNC T threadgroup_sum##SUFFIX \
+ ( \
+  T x, threadgroup T *scratch, ushort simd_lane_id, \
+  ushort simdgroup_index_in_threadgroup, ushort simdgroups_per_threadgroup) \
+{ \
+  return __threadgroup_reduce<V>( \
+    x, scratch, simd_lane_id, simdgroup_index_in_threadgroup, \
+    simdgroups_per_threadgroup); \
+} \
+METAL_FUNC T threadgroup_prefix_inclusive_sum##SUFFIX \
+ ( \
+  T x, threadgroup T *scratch, ushort simd_lane_id, \
+  ushort simdgroup_index_in_threadgroup, ushort simdgroups_per_threadgroup) \
+{ \
+  return __threadgroup_prefix<V>( \
+    x, scratch, simd_lane_id, simdgroup_index_in_threadgroup, \
+    simdgroups_per_threadgroup, true); \
+} \
+METAL_FUNC T threadgroup_prefix_exclusive_sum##SUFFIX \
+ ( \
+  T x, threadgroup T *scratch, ushort simd_lane_id, \
+  ushort simdgroup_index_in_threadgroup, ushort simdgroups_per_threadgroup) \
+{ \
+  return __threadgroup_prefix<V>( \
+    x, scratch, simd_lane_id, simdgroup_index_in_threadgroup, \
+    simdgroups_per_threadgroup, false); \
+} \
+
+SIMD_REDUCTIONS(float64_t, , float64_t);
+SIMD_REDUCTIONS(float32x2_t, , float32x2_t);
+SIMD_REDUCTIONS(float64_t, _compensated, __float64_compensated_t);
+SIMD_REDUCTIONS(float32x2_t, _compensated, __float32x2_compensated_t);
+
+#undef SIMD_REDUCTIONS
+} // namespace metal_float64
@@ -560,6 +560,7 @@ struct __base_vec<T, I> { \
 }; \
 
 MAKE_METAL_FLOAT64_BASE(float64_t);
+MAKE_METAL_FLOAT64_BASE(float32x2_t);
 MAKE_METAL_FLOAT64_BASE(float59_t);
 MAKE_METAL_FLOAT64_BASE(float43_t);
 
@@ -570,6 +571,12 @@ MAKE_METAL_FLOAT64_BASE(float43_t);
 template <typename T, uint I>
 using __metal_float64_common_vec = typename __base_vec<T, I>::actual_vec;
 
+// Unlike `__metal_float64_common_vec`, template arguments can be deduced from
+// this alias. Use it in generic functions that accept vectors of any 64-bit
+// type.
+template <typename T, uint I>
+using __metal_float64_vec = vec<T, I>;
+
 } // namespace metal_float64
 
 // Enter the workaround into the `metal` namespace and global context.
@@ -0,0 +1,41 @@
+//
+//  AccumulatorTests.metal
+//  MetalFloat64
+//
+
+#include <metal_stdlib>
+#include <metal_float64>
+using namespace metal;
+
+// Each operation unpacks, operates, then rounds once. The results should match
+// the CPU bit for bit.
+kernel void testFloat64Arithmetic
+ (
+  device double *lhs [[buffer(0)]],
+  device double *rhs [[buffer(1)]],
+  device double *output [[buffer(2)]],
+  uint tid [[thread_position_in_grid]])
+{
+  double a = lhs[tid];
+  double b = rhs[tid];
+  output[3 * tid + 0] = a + b;
+  output[3 * tid + 1] = a - b;
+  output[3 * tid + 2] = a * b;
+}
+
+// Only rounds when storing the result.
+kernel void testAccumulatorDotProduct
+ (
+  constant uint &itemsPerThread [[buffer(0)]],
+  device double *lhs [[buffer(1)]],
+  device double *rhs [[buffer(2)]],
+  device double *output [[buffer(3)]],
+  uint tid [[thread_position_in_grid]])
+{
+  uint base = tid * itemsPerThread;
+  float64_accum_t sum = float64_accum_t(lhs[base]) * rhs[base];
+  for (uint i = 1; i < itemsPerThread; ++i) {
+    sum += float64_accum_t(lhs[base + i]) * rhs[base + i];
+  }
+  output[tid] = sum;
+}
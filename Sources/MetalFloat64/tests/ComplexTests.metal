@@ -0,0 +1,166 @@
+//
+//  ComplexTests.metal
+//  MetalFloat64
+//
+
+#include <metal_stdlib>
+#include <metal_float64>
+using namespace metal;
+
+// Complex numbers are stored as interleaved (real, imaginary) pairs in every
+// buffer.
+template <typename T>
+complex<T> loadComplex(device T *data, uint index)
+{
+  return complex<T>(data[2 * index], data[2 * index + 1]);
+}
+
+template <typename T>
+void storeComplex(device T *data, uint index, complex<T> x)
+{
+  data[2 * index] = x.real();
+  data[2 * index + 1] = x.imag();
+}
+
+// Outputs a * b, fma(a, b, c), and norm(a).
+template <typename T>
+kernel void testComplexArithmetic
+ (
+  device T *input [[buffer(0)]],
+  device T *output [[buffer(1)]],
+  uint tid [[thread_position_in_grid]])
+{
+  complex<T> a = loadComplex(input, 3 * tid + 0);
+  complex<T> b = loadComplex(input, 3 * tid + 1);
+  complex<T> c = loadComplex(input, 3 * tid + 2);
+  storeComplex(output, 3 * tid + 0, a * b);
+  storeComplex(output, 3 * tid + 1, fma(a, b, c));
+  output[6 * tid + 4] = norm(a);
+  output[6 * tid + 5] = T();
+}
+
+// Each thread transforms 16 points, which stay in registers.
+constant uint fftSize = 16;
+
+template <uint Radix>
+uint digitReverse(uint index)
+{
+  uint output = 0;
+  for (uint i = 1; i < fftSize; i *= Radix) {
+    output = output * Radix + index % Radix;
+    index /= Radix;
+  }
+  return output;
+}
+
+// Forward transform from bit- or digit-reversed order to natural order.
+template <typename T, uint Radix>
+void fft(thread complex<T> *x, device T *twiddles)
+{
+  if (Radix == 2) {
+    for (uint m = 2; m <= fftSize; m *= 2) {
+      for (uint k = 0; k < fftSize; k += m) {
+        for (uint j = 0; j < m / 2; ++j) {
+          complex<T> w = loadComplex(twiddles, j * (fftSize / m));
+          fft_butterfly2(x[k + j], x[k + j + m / 2], w);
+        }
+      }
+    }
+  } else {
+    for (uint m = 4; m <= fftSize; m *= 4) {
+      uint q = m / 4;
+      for (uint k = 0; k < fftSize; k += m) {
+        for (uint j = 0; j < q; ++j) {
+          complex<T> w1 = loadComplex(twiddles, 1 * j * (fftSize / m));
+          complex<T> w2 = loadComplex(twiddles, 2 * j * (fftSize / m));
+          complex<T> w3 = loadComplex(twiddles, 3 * j * (fftSize / m));
+          fft_butterfly4(
+            x[k + j], x[k + j + q], x[k + j + 2 * q], x[k + j + 3 * q],
+            w1, w2, w3);
+        }
+      }
+    }
+  }
+}
+
+template <typename T, uint Radix>
+kernel void testFFT
+ (
+  device T *twiddles [[buffer(0)]],
+  device T *input [[buffer(1)]],
+  device T *output [[buffer(2)]],
+  uint tid [[thread_position_in_grid]])
+{
+  complex<T> x[fftSize];
+  for (uint i = 0; i < fftSize; ++i) {
+    x[digitReverse<Radix>(i)] = loadComplex(input, fftSize * tid + i);
+  }
+  fft<T, Radix>(x, twiddles);
+  for (uint i = 0; i < fftSize; ++i) {
+    storeComplex(output, fftSize * tid + i, x[i]);
+  }
+}
+
+// Repeatedly transforms the data in place, dividing by the size each time so
+// the values stay bounded. The division is exact.
+template <typename T, uint Radix>
+kernel void benchmarkFFT
+ (
+  constant uint &iterations [[buffer(0)]],
+  device T *twiddles [[buffer(1)]],
+  device T *data [[buffer(2)]],
+  uint tid [[thread_position_in_grid]])
+{
+  complex<T> x[fftSize];
+  for (uint i = 0; i < fftSize; ++i) {
+    x[i] = loadComplex(data, fftSize * tid + i);
+  }
+  T scale = convert<T>(1.0f / fftSize);
+  for (uint iteration = 0; iteration < iterations; ++iteration) {
+    complex<T> reversed[fftSize];
+    for (uint i = 0; i < fftSize; ++i) {
+      reversed[digitReverse<Radix>(i)] = x[i] * scale;
+    }
+    fft<T, Radix>(reversed, twiddles);
+    for (uint i = 0; i < fftSize; ++i) {
+      x[i] = reversed[i];
+    }
+  }
+  for (uint i = 0; i < fftSize; ++i) {
+    storeComplex(data, fftSize * tid + i, x[i]);
+  }
+}
+
+#define COMPLEX_KERNELS(NAME, T) \
+template [[host_name("testComplexArithmetic" #NAME)]] \
+kernel void testComplexArithmetic<T> \
+ ( \
+  device T *input [[buffer(0)]], \
+  device T *output [[buffer(1)]], \
+  uint tid [[thread_position_in_grid]]); \
+\
+FFT_KERNELS(Radix2##NAME, T, 2); \
+FFT_KERNELS(Radix4##NAME, T, 4); \
+
+#define FFT_KERNELS(NAME, T, RADIX) \
+template [[host_name("testFFT" #NAME)]] \
+kernel void testFFT<T, RADIX> \
+ ( \
+  device T *twiddles [[buffer(0)]], \
+  device T *input [[buffer(1)]], \
+  device T *output [[buffer(2)]], \
+  uint tid [[thread_position_in_grid]]); \
+\
+template [[host_name("benchmarkFFT" #NAME)]] \
+kernel void benchmarkFFT<T, RADIX> \
+ ( \
+  constant uint &iterations [[buffer(0)]], \
+  device T *twiddles [[buffer(1)]], \
+  device T *data [[buffer(2)]], \
+  uint tid [[thread_position_in_grid]]); \
+
+COMPLEX_KERNELS(Float64, float64_t);
+COMPLEX_KERNELS(Float32x2, float32x2_t);
+
+#undef COMPLEX_KERNELS
+#undef FFT_KERNELS
@@ -0,0 +1,103 @@
+//
+//  ConversionTests.metal
+//  MetalFloat64
+//
+
+#include <metal_stdlib>
+#include <metal_float64>
+using namespace metal;
+
+// Conversions from `double` to every other format, in both rounding modes.
+// The results should match the CPU bit for bit.
+kernel void testConversionsFromDouble
+ (
+  device double *input [[buffer(0)]],
+  device float *floatOutput [[buffer(1)]],
+  device half *halfOutput [[buffer(2)]],
+  device int *intOutput [[buffer(3)]],
+  device long *longOutput [[buffer(4)]],
+  device float32x2_t *float32x2Output [[buffer(5)]],
+  device ulong *reducedOutput [[buffer(6)]],
+  uint tid [[thread_position_in_grid]])
+{
+  constexpr rounding_mode truncate = rounding_mode::truncate;
+  double x = input[tid];
+  floatOutput[2 * tid + 0] = convert<float>(x);
+  floatOutput[2 * tid + 1] = convert<float, truncate>(x);
+  halfOutput[2 * tid + 0] = convert<half>(x);
+  halfOutput[2 * tid + 1] = convert<half, truncate>(x);
+  intOutput[2 * tid + 0] = convert<int>(x);
+  intOutput[2 * tid + 1] = convert<int, truncate>(x);
+  longOutput[2 * tid + 0] = convert<long>(x);
+  longOutput[2 * tid + 1] = convert<long, truncate>(x);
+  float32x2Output[2 * tid + 0] = convert<float32x2_t>(x);
+  float32x2Output[2 * tid + 1] = convert<float32x2_t, truncate>(x);
+  reducedOutput[4 * tid + 0] = convert<float59_t>(x).data;
+  reducedOutput[4 * tid + 1] = convert<float59_t, truncate>(x).data;
+  reducedOutput[4 * tid + 2] = convert<float43_t>(x).data;
+  reducedOutput[4 * tid + 3] = convert<float43_t, truncate>(x).data;
+}
+
+// Conversions from native formats to `double`.
+kernel void testConversionsToDouble
+ (
+  device float *floatInput [[buffer(0)]],
+  device half *halfInput [[buffer(1)]],
+  device int *intInput [[buffer(2)]],
+  device long *longInput [[buffer(3)]],
+  device double *output [[buffer(4)]],
+  uint tid [[thread_position_in_grid]])
+{
+  output[4 * tid + 0] = convert<double>(floatInput[tid]);
+  output[4 * tid + 1] = convert<double>(halfInput[tid]);
+  output[4 * tid + 2] = convert<double>(intInput[tid]);
+  output[4 * tid + 3] = convert<double>(longInput[tid]);
+}
+
+// The vector overloads should match the scalar ones bit for bit.
+kernel void testConversionVectors
+ (
+  device double4 *input [[buffer(0)]],
+  device float4 *output [[buffer(1)]],
+  uint tid [[thread_position_in_grid]])
+{
+  double4 x = input[tid];
+  float4 vector = convert<float>(x);
+  float4 scalar = float4(
+    convert<float>(double(x.x)), convert<float>(double(x.y)),
+    convert<float>(double(x.z)), convert<float>(double(x.w)));
+  output[2 * tid + 0] = vector;
+  output[2 * tid + 1] = scalar;
+}
+
+// Each iteration narrows, then widens back to `double`.
+template <typename T>
+kernel void benchmarkConversion
+ (
+  constant uint &iterations [[buffer(0)]],
+  device double *data [[buffer(1)]],
+  uint tid [[thread_position_in_grid]])
+{
+  double x = data[tid];
+  for (uint i = 0; i < iterations; ++i) {
+    x = convert<double>(convert<T>(x));
+  }
+  data[tid] = x;
+}
+
+#define BENCHMARK_CONVERSION(NAME, T) \
+template [[host_name("benchmarkConversion" #NAME)]] \
+kernel void benchmarkConversion<T> \
+ ( \
+  constant uint &iterations [[buffer(0)]], \
+  device double *data [[buffer(1)]], \
+  uint tid [[thread_position_in_grid]]); \
+
+BENCHMARK_CONVERSION(Float, float);
+BENCHMARK_CONVERSION(Half, half);
+BENCHMARK_CONVERSION(Long, long);
+BENCHMARK_CONVERSION(Float32x2, float32x2_t);
+BENCHMARK_CONVERSION(Float59, float59_t);
+BENCHMARK_CONVERSION(Float43, float43_t);
+
+#undef BENCHMARK_CONVERSION
@@ -0,0 +1,169 @@
+//
+//  CoreParityTests.metal
+//  MetalFloat64
+//
+
+#include <metal_stdlib>
+#include <metal_float64>
+#include <MetalFloat64Core/MetalFloat64Core.h>
+using namespace metal;
+
+// Runs every operation through both the portable core and the MSL headers.
+// The results should match bit for bit.
+kernel void testCoreParityFloat64
+ (
+  device double *input [[buffer(0)]],
+  device ulong *output [[buffer(1)]],
+  uint tid [[thread_position_in_grid]])
+{
+  double x = input[2 * tid + 0];
+  double y = input[2 * tid + 1];
+  mf64_float64_t a = { x.data };
+  mf64_float64_t b = { y.data };
+
+  output[6 * tid + 0] = mf64_float64_add(a, b).data;
+  output[6 * tid + 1] = (x + y).data;
+  output[6 * tid + 2] = mf64_float64_subtract(a, b).data;
+  output[6 * tid + 3] = (x - y).data;
+  output[6 * tid + 4] = mf64_float64_multiply(a, b).data;
+  output[6 * tid + 5] = (x * y).data;
+}
+
+kernel void testCoreParityFloat32x2
+ (
+  device float2 *input [[buffer(0)]],
+  device float2 *output [[buffer(1)]],
+  uint tid [[thread_position_in_grid]])
+{
+  float2 inputs[3] = {
+    input[3 * tid + 0], input[3 * tid + 1], input[3 * tid + 2]
+  };
+  mf64_float32x2_t core[3];
+  float32x2_t msl[3];
+  for (uint i = 0; i < 3; ++i) {
+    core[i] = { inputs[i][0], inputs[i][1] };
+    msl[i] = float32x2_t(inputs[i][0], inputs[i][1]);
+  }
+
+  mf64_float32x2_t core_outputs[4] = {
+    mf64_float32x2_add(core[0], core[1]),
+    mf64_float32x2_subtract(core[0], core[1]),
+    mf64_float32x2_multiply(core[0], core[1]),
+    mf64_float32x2_fma(core[0], core[1], core[2]),
+  };
+  float32x2_t msl_outputs[4] = {
+    msl[0] + msl[1],
+    msl[0] - msl[1],
+    msl[0] * msl[1],
+    fma(msl[0], msl[1], msl[2]),
+  };
+  for (uint i = 0; i < 4; ++i) {
+    output[8 * tid + 2 * i + 0] = { core_outputs[i].hi, core_outputs[i].lo };
+    output[8 * tid + 2 * i + 1] = { msl_outputs[i].hi, msl_outputs[i].lo };
+  }
+}
+
+// Outputs (result, error) pairs from the MSL `two_sum`, `two_prod`, `split`,
+// and `fast_two_sum`, which the test compares against the portable core on the host. The
+// vector overloads are compared against the scalar ones here, setting a bit in
+// `mismatches` for each lane that differs.
+kernel void testCoreParityErrorFree
+ (
+  device double *input [[buffer(0)]],
+  device float *floatInput [[buffer(1)]],
+  device ulong *output [[buffer(2)]],
+  device float *floatOutput [[buffer(3)]],
+  device uint *mismatches [[buffer(4)]],
+  uint tid [[thread_position_in_grid]])
+{
+  double x = input[2 * tid + 0];
+  double y = input[2 * tid + 1];
+  device ulong *pairs = output + 8 * tid;
+  double error;
+  pairs[0] = two_sum(x, y, error).data;
+  pairs[1] = error.data;
+  pairs[2] = two_prod(x, y, error).data;
+  pairs[3] = error.data;
+  pairs[4] = split(x, error).data;
+  pairs[5] = error.data;
+
+  // `fast_two_sum` requires |a| >= |b|, so order the inputs by magnitude.
+  bool swap_inputs =
+    (x.data & 0x7FFFFFFFFFFFFFFF) < (y.data & 0x7FFFFFFFFFFFFFFF);
+  double big = swap_inputs ? y : x;
+  double small = swap_inputs ? x : y;
+  pairs[6] = fast_two_sum(big, small, error).data;
+  pairs[7] = error.data;
+
+  float fx = floatInput[2 * tid + 0];
+  float fy = floatInput[2 * tid + 1];
+  device float *float_pairs = floatOutput + 8 * tid;
+  float float_error;
+  float_pairs[0] = two_sum(fx, fy, float_error);
+  float_pairs[1] = float_error;
+  float_pairs[2] = two_prod(fx, fy, float_error);
+  float_pairs[3] = float_error;
+  float_pairs[4] = split(fx, float_error);
+  float_pairs[5] = float_error;
+
+  bool swap_float_inputs = abs(fx) < abs(fy);
+  float fbig = swap_float_inputs ? fy : fx;
+  float fsmall = swap_float_inputs ? fx : fy;
+  float_pairs[6] = fast_two_sum(fbig, fsmall, float_error);
+  float_pairs[7] = float_error;
+
+  // Vectors repeat the scalar inputs in shuffled lanes. The `fast_two_sum`
+  // lanes keep the larger magnitude on the left.
+  float4 va(fx, fy, -fx, fy);
+  float4 vb(fy, fx, fy, -fx);
+  float4 verror;
+  float4 vsum = two_sum(va, vb, verror);
+  float4 vbig(fbig, -fbig, fbig, -fbig);
+  float4 vsmall(fsmall, fsmall, -fsmall, -fsmall);
+  float4 vfast_error;
+  float4 vfast_sum = fast_two_sum(vbig, vsmall, vfast_error);
+  uint errors = 0;
+  for (uint i = 0; i < 4; ++i) {
+    float scalar_error;
+    float scalar_sum = two_sum(va[i], vb[i], scalar_error);
+    errors |= uint(as_type<uint>(scalar_sum) != as_type<uint>(vsum[i]) ||
+                   as_type<uint>(scalar_error) != as_type<uint>(verror[i]))
+      << i;
+    scalar_sum = fast_two_sum(vbig[i], vsmall[i], scalar_error);
+    errors |= uint(as_type<uint>(scalar_sum) != as_type<uint>(vfast_sum[i]) ||
+                   as_type<uint>(scalar_error) != as_type<uint>(vfast_error[i]))
+      << (4 + i);
+  }
+
+  double2 da(x, y);
+  double2 db(y, x);
+  double2 derror;
+  double2 dproduct = two_prod(da, db, derror);
+  double2 dbig(big, -big);
+  double2 dsmall(small, small);
+  double2 dfast_error;
+  double2 dfast_sum = fast_two_sum(dbig, dsmall, dfast_error);
+  double2 dsplit_lo;
+  double2 dsplit_hi = split(da, dsplit_lo);
+  double products[2] = { double(dproduct.x), double(dproduct.y) };
+  double product_errors[2] = { double(derror.x), double(derror.y) };
+  double fast_sums[2] = { double(dfast_sum.x), double(dfast_sum.y) };
+  double fast_errors[2] = { double(dfast_error.x), double(dfast_error.y) };
+  double split_his[2] = { double(dsplit_hi.x), double(dsplit_hi.y) };
+  double split_los[2] = { double(dsplit_lo.x), double(dsplit_lo.y) };
+  double lhs[2] = { x, y };
+  double bigs[2] = { big, -big };
+  for (uint i = 0; i < 2; ++i) {
+    double scalar_error;
+    double scalar_product = two_prod(lhs[i], lhs[1 - i], scalar_error);
+    errors |= uint(scalar_product.data != products[i].data ||
+                   scalar_error.data != product_errors[i].data) << (8 + i);
+    double scalar_sum = fast_two_sum(bigs[i], small, scalar_error);
+    errors |= uint(scalar_sum.data != fast_sums[i].data ||
+                   scalar_error.data != fast_errors[i].data) << (10 + i);
+    double scalar_hi = split(lhs[i], scalar_error);
+    errors |= uint(scalar_hi.data != split_his[i].data ||
+                   scalar_error.data != split_los[i].data) << (12 + i);
+  }
+  mismatches[tid] = errors;
+}
@@ -0,0 +1,144 @@
+//
+//  PolynomialTests.metal
+//  MetalFloat64
+//
+
+#include <metal_stdlib>
+#include <metal_float64>
+using namespace metal;
+
+// Taylor series of exp(-x), which is accurate to <1 ulp when |x| <= 0.25.
+// Repeatedly applying it converges to the omega constant, so the benchmarks
+// can feed each result into the next iteration.
+
+constant float64_t expCoefficients64[14] = {
+  { 0x3FF0000000000000 },
+  { 0xBFF0000000000000 },
+  { 0x3FE0000000000000 },
+  { 0xBFC5555555555555 },
+  { 0x3FA5555555555555 },
+  { 0xBF81111111111111 },
+  { 0x3F56C16C16C16C17 },
+  { 0xBF2A01A01A01A01A },
+  { 0x3EFA01A01A01A01A },
+  { 0xBEC71DE3A556C734 },
+  { 0x3E927E4FB7789F5C },
+  { 0xBE5AE64567F544E4 },
+  { 0x3E21EED8EFF8D898 },
+  { 0xBDE6124613A86D09 },
+};
+
+constant float32x2_t expCoefficients32x2[14] = {
+  float32x2_split(0x3FF0000000000000),
+  float32x2_split(0xBFF0000000000000),
+  float32x2_split(0x3FE0000000000000),
+  float32x2_split(0xBFC5555555555555),
+  float32x2_split(0x3FA5555555555555),
+  float32x2_split(0xBF81111111111111),
+  float32x2_split(0x3F56C16C16C16C17),
+  float32x2_split(0xBF2A01A01A01A01A),
+  float32x2_split(0x3EFA01A01A01A01A),
+  float32x2_split(0xBEC71DE3A556C734),
+  float32x2_split(0x3E927E4FB7789F5C),
+  float32x2_split(0xBE5AE64567F544E4),
+  float32x2_split(0x3E21EED8EFF8D898),
+  float32x2_split(0xBDE6124613A86D09),
+};
+
+// Rounded to single precision, to exercise the mixed-precision paths.
+constant float expCoefficients32[14] = {
+  0x1.000000p+0,
+  -0x1.000000p+0,
+  0x1.000000p-1,
+  -0x1.555556p-3,
+  0x1.555556p-5,
+  -0x1.111112p-7,
+  0x1.6c16c2p-10,
+  -0x1.a01a02p-13,
+  0x1.a01a02p-16,
+  -0x1.71de3ap-19,
+  0x1.27e4fcp-22,
+  -0x1.ae6456p-26,
+  0x1.1eed8ep-29,
+  -0x1.612462p-33,
+};
+
+template <typename C>
+constant C *expCoefficients();
+
+template <>
+constant float64_t *expCoefficients() { return expCoefficients64; }
+
+template <>
+constant float32x2_t *expCoefficients() { return expCoefficients32x2; }
+
+template <>
+constant float *expCoefficients() { return expCoefficients32; }
+
+template <polynomial_scheme Scheme, typename T, typename C>
+kernel void testPolynomial
+ (
+  device T *input [[buffer(0)]],
+  device T *output [[buffer(1)]],
+  uint tid [[thread_position_in_grid]])
+{
+  output[tid] = polyval<13, Scheme>(input[tid], expCoefficients<C>());
+}
+
+template <polynomial_scheme Scheme, typename T, typename C>
+kernel void benchmarkPolynomial
+ (
+  constant uint &iterations [[buffer(0)]],
+  device T *data [[buffer(1)]],
+  uint tid [[thread_position_in_grid]])
+{
+  T x = data[tid];
+  for (uint i = 0; i < iterations; ++i) {
+    x = polyval<13, Scheme>(x, expCoefficients<C>());
+  }
+  data[tid] = x;
+}
+
+#define POLYNOMIAL_KERNELS(NAME, SCHEME, T, C) \
+template [[host_name("testPolynomial" #NAME)]] \
+kernel void testPolynomial<polynomial_scheme::SCHEME, T, C> \
+ ( \
+  device T *input [[buffer(0)]], \
+  device T *output [[buffer(1)]], \
+  uint tid [[thread_position_in_grid]]); \
+\
+template [[host_name("benchmarkPolynomial" #NAME)]] \
+kernel void benchmarkPolynomial<polynomial_scheme::SCHEME, T, C> \
+ ( \
+  constant uint &iterations [[buffer(0)]], \
+  device T *data [[buffer(1)]], \
+  uint tid [[thread_position_in_grid]]); \
+
+POLYNOMIAL_KERNELS(HornerFloat64, horner, float64_t, float64_t);
+POLYNOMIAL_KERNELS(HornerFloat64Mixed, horner, float64_t, float);
+POLYNOMIAL_KERNELS(EstrinFloat64, estrin, float64_t, float64_t);
+POLYNOMIAL_KERNELS(EstrinFloat64Mixed, estrin, float64_t, float);
+POLYNOMIAL_KERNELS(HornerFloat32x2, horner, float32x2_t, float32x2_t);
+POLYNOMIAL_KERNELS(HornerFloat32x2Mixed, horner, float32x2_t, float);
+POLYNOMIAL_KERNELS(EstrinFloat32x2, estrin, float32x2_t, float32x2_t);
+POLYNOMIAL_KERNELS(EstrinFloat32x2Mixed, estrin, float32x2_t, float);
+
+#undef POLYNOMIAL_KERNELS
+
+// The vector overloads should match the scalar ones bit for bit.
+kernel void testPolynomialVector
+ (
+  device double2 *input [[buffer(0)]],
+  device double2 *output [[buffer(1)]],
+  uint tid [[thread_position_in_grid]])
+{
+  constant double *coefficients = expCoefficients64;
+  double2 x = input[tid];
+  double x0 = x.x;
+  double x1 = x.y;
+  double2 vector = polyval<13, polynomial_scheme::estrin>(x, coefficients);
+  double scalar0 = polyval<13, polynomial_scheme::estrin>(x0, coefficients);
+  double scalar1 = polyval<13, polynomial_scheme::estrin>(x1, coefficients);
+  output[2 * tid + 0] = vector;
+  output[2 * tid + 1] = double2(scalar0, scalar1);
+}
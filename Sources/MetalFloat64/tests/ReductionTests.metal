@@ -0,0 +1,112 @@
+//
+//  ReductionTests.metal
+//  MetalFloat64
+//
+
+#include <metal_stdlib>
+#include <metal_float64>
+using namespace metal;
+
+// Every sum and scan over one SIMD-group, in six consecutive outputs per
+// thread. The CPU replays the same order of additions.
+template <typename T>
+kernel void testSimdReduction
+ (
+  device T *input [[buffer(0)]],
+  device T *output [[buffer(1)]],
+  uint tid [[thread_position_in_grid]])
+{
+  T x = input[tid];
+  output[6 * tid + 0] = simd_sum(x);
+  output[6 * tid + 1] = simd_prefix_inclusive_sum(x);
+  output[6 * tid + 2] = simd_prefix_exclusive_sum(x);
+  output[6 * tid + 3] = simd_sum_compensated(x);
+  output[6 * tid + 4] = simd_prefix_inclusive_sum_compensated(x);
+  output[6 * tid + 5] = simd_prefix_exclusive_sum_compensated(x);
+}
+
+// The same outputs as `testSimdReduction`, over the entire threadgroup.
+template <typename T>
+kernel void testThreadgroupReduction
+ (
+  device T *input [[buffer(0)]],
+  device T *output [[buffer(1)]],
+  uint tid [[thread_position_in_grid]],
+  ushort lane [[thread_index_in_simdgroup]],
+  ushort simdgroup [[simdgroup_index_in_threadgroup]],
+  ushort simdgroups [[simdgroups_per_threadgroup]])
+{
+  // Two elements per SIMD-group, for up to 1024 threads.
+  threadgroup T scratch[64];
+  T x = input[tid];
+  output[6 * tid + 0] = threadgroup_sum(
+    x, scratch, lane, simdgroup, simdgroups);
+  output[6 * tid + 1] = threadgroup_prefix_inclusive_sum(
+    x, scratch, lane, simdgroup, simdgroups);
+  output[6 * tid + 2] = threadgroup_prefix_exclusive_sum(
+    x, scratch, lane, simdgroup, simdgroups);
+  output[6 * tid + 3] = threadgroup_sum_compensated(
+    x, scratch, lane, simdgroup, simdgroups);
+  output[6 * tid + 4] = threadgroup_prefix_inclusive_sum_compensated(
+    x, scratch, lane, simdgroup, simdgroups);
+  output[6 * tid + 5] = threadgroup_prefix_exclusive_sum_compensated(
+    x, scratch, lane, simdgroup, simdgroups);
+}
+
+// Each iteration sums the SIMD-group, then divides by 32 so the values stay
+// bounded. The division is exact.
+template <typename T, bool Compensated>
+kernel void benchmarkReduction
+ (
+  constant uint &iterations [[buffer(0)]],
+  device T *data [[buffer(1)]],
+  uint tid [[thread_position_in_grid]])
+{
+  T x = data[tid];
+  for (uint i = 0; i < iterations; ++i) {
+    if (Compensated) {
+      x = simd_sum_compensated(x);
+    } else {
+      x = simd_sum(x);
+    }
+    x = x * 0.03125f;
+  }
+  data[tid] = x;
+}
+
+#define REDUCTION_KERNELS(NAME, T) \
+template [[host_name("testSimdReduction" #NAME)]] \
+kernel void testSimdReduction<T> \
+ ( \
+  device T *input [[buffer(0)]], \
+  device T *output [[buffer(1)]], \
+  uint tid [[thread_position_in_grid]]); \
+\
+template [[host_name("testThreadgroupReduction" #NAME)]] \
+kernel void testThreadgroupReduction<T> \
+ ( \
+  device T *input [[buffer(0)]], \
+  device T *output [[buffer(1)]], \
+  uint tid [[thread_position_in_grid]], \
+  ushort lane [[thread_index_in_simdgroup]], \
+  ushort simdgroup [[simdgroup_index_in_threadgroup]], \
+  ushort simdgroups [[simdgroups_per_threadgroup]]); \
+\
+template [[host_name("benchmarkReduction" #NAME)]] \
+kernel void benchmarkReduction<T, false> \
+ ( \
+  constant uint &iterations [[buffer(0)]], \
+  device T *data [[buffer(1)]], \
+  uint tid [[thread_position_in_grid]]); \
+\
+template [[host_name("benchmarkReduction" #NAME "Compensated")]] \
+kernel void benchmarkReduction<T, true> \
+ ( \
+  constant uint &iterations [[buffer(0)]], \
+  device T *data [[buffer(1)]], \
+  uint tid [[thread_position_in_grid]]); \
+
+REDUCTION_KERNELS(Float64, float64_t);
+REDUCTION_KERNELS(Float32x2, float32x2_t);
+
+#undef REDUCTION_KERNELS
@@ -0,0 +1,980 @@
+//
+//  MetalFloat64Core.h
+//  MetalFloat64
+//
+
+#ifndef MetalFloat64Core_h
+#define MetalFloat64Core_h
+
+// Header-only arithmetic core of MetalFloat64, written in the common subset of
+// C99, OpenCL C, and the Metal Shading Language. It has no address spaces,
+// classes, or templates, so other GPU backends (e.g. OpenMM's OpenCL platform)
+// and CPU fallbacks can share it. "metal_float64" includes this header, and
+// its `float64_t`, `float64_accum_t`, and `float32x2_t` operators forward to
+// the functions below.
+//
+// Results match the MSL operators bit for bit, as long as the compiler
+// preserves the order of floating-point operations:
+// - C: do not compile with `-ffast-math` or `-ffp-contract=fast`.
+// - OpenCL: do not compile with `-cl-fast-relaxed-math`,
+//   `-cl-unsafe-math-optimizations`, or `-cl-no-signed-zeros`.
+// - MSL: fast math is fine, because every error-free transformation disables
+//   reassociation locally.
+//
+// The OpenCL branch needs OpenCL C 1.2 or later, which allows `static`
+// functions. "build.sh" type-checks it with Clang, but nothing runs it on a
+// device. The C branch runs in `swift test`, and the MSL branch in the GPU
+// tests.
+//
+// All functions are prefixed with `mf64_`. Define
+// `METAL_FLOAT64_DISABLE_EDGE_CASES` before including this header to skip INF
+// and NAN handling, the same as for "metal_float64".
+
+// MARK: - Portability
+
+#if defined(__METAL_VERSION__)
+typedef ulong mf64_ulong;
+typedef uint mf64_uint;
+typedef long mf64_long;
+typedef ushort mf64_ushort;
+#define MF64_FUNC static inline __attribute__((__always_inline__))
+#define MF64_AS_UINT(x) as_type<uint>(x)
+#define MF64_AS_FLOAT(x) as_type<float>(x)
+#define MF64_FMA(a, b, c) metal::fma(a, b, c)
+#define MF64_MULHI(a, b) metal::mulhi(a, b)
+#define MF64_CLZ(x) mf64_ulong(metal::clz(x))
+// Vendor compilers define `__OPENCL_VERSION__`, but upstream Clang only
+// defines `__OPENCL_C_VERSION__`, which OpenCL 1.0 lacks.
+#elif defined(__OPENCL_VERSION__) || defined(__OPENCL_C_VERSION__)
+typedef ulong mf64_ulong;
+typedef uint mf64_uint;
+typedef long mf64_long;
+typedef ushort mf64_ushort;
+#define MF64_FUNC static inline
+#define MF64_AS_UINT(x) as_uint(x)
+#define MF64_AS_FLOAT(x) as_float(x)
+#define MF64_FMA(a, b, c) fma(a, b, c)
+#define MF64_MULHI(a, b) mul_hi(a, b)
+#define MF64_CLZ(x) clz(x)
+#else
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+typedef uint64_t mf64_ulong;
+typedef uint32_t mf64_uint;
+typedef int64_t mf64_long;
+typedef uint16_t mf64_ushort;
+#define MF64_FUNC static inline
+#define MF64_AS_UINT(x) mf64_as_uint(x)
+#define MF64_AS_FLOAT(x) mf64_as_float(x)
+#define MF64_FMA(a, b, c) fmaf(a, b, c)
+#define MF64_MULHI(a, b) mf64_mulhi(a, b)
+#define MF64_CLZ(x) mf64_clz(x)
+
+MF64_FUNC mf64_uint mf64_as_uint(float x)
+{
+  mf64_uint output;
+  memcpy(&output, &x, sizeof(output));
+  return output;
+}
+
+MF64_FUNC float mf64_as_float(mf64_uint x)
+{
+  float output;
+  memcpy(&output, &x, sizeof(output));
+  return output;
+}
+
+MF64_FUNC mf64_ulong mf64_mulhi(mf64_ulong a, mf64_ulong b)
+{
+#if defined(__SIZEOF_INT128__)
+  __extension__ typedef unsigned __int128 mf64_uint128;
+  return (mf64_ulong)(((mf64_uint128)a * b) >> 64);
+#else
+  mf64_ulong a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+  mf64_ulong b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+  mf64_ulong lo_lo = a_lo * b_lo;
+  mf64_ulong hi_lo = a_hi * b_lo;
+  mf64_ulong lo_hi = a_lo * b_hi;
+  mf64_ulong middle = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  return a_hi * b_hi + (hi_lo >> 32) + (middle >> 32);
+#endif
+}
+
+// Unlike the builtin, returns 64 for zero.
+MF64_FUNC mf64_ulong mf64_clz(mf64_ulong x)
+{
+#if defined(__GNUC__)
+  return (x == 0) ? 64 : (mf64_ulong)__builtin_clzll(x);
+#else
+  mf64_ulong output = 0;
+  for (; output < 64 && !(x >> (63 - output) & 1); ++output) {}
+  return output;
+#endif
+}
+#endif
+
+// The equivalent of PRECISE_MATH from "Defines.h".
+#if defined(__clang__)
+#define MF64_PRECISE_MATH _Pragma("clang fp reassociate(off)")
+#else
+#define MF64_PRECISE_MATH
+#endif
+
+// MARK: - Types
+
+// IEEE double precision, stored as its bit pattern. Same layout as
+// `float64_t` and the CPU's `double`.
+typedef struct {
+  mf64_ulong data;
+} mf64_float64_t;
+
+// The unevaluated sum of two floats, where `lo` is at most half an ulp of
+// `hi`. Same layout as `float32x2_t`.
+typedef struct {
+  float hi;
+  float lo;
+} mf64_float32x2_t;
+
+// Reduced-precision formats with the same layout as `mf64_float64_t`, where the
+// lowest 5 or 21 bits of the mantissa are always zero. Same as `float59_t` and
+// `float43_t`.
+typedef struct {
+  mf64_ulong data;
+} mf64_float59_t;
+
+typedef struct {
+  mf64_ulong data;
+} mf64_float43_t;
+
+// An `mf64_float64_t` and its exact error, returned by the error-free
+// transformations.
+typedef struct {
+  mf64_float64_t hi;
+  mf64_float64_t lo;
+} mf64_float64x2_t;
+
+// Unpacked `mf64_float64_t`, with the leading one at bit 61 of the mantissa.
+// Same algorithms as `float64_accum_t`, including the error bounds.
+typedef struct {
+  mf64_ulong mantissa;
+  int exponent;
+  mf64_uint sign;
+} mf64_accum_t;
+
+#define MF64_ZERO_EXPONENT (-0x40000000)
+#define MF64_SPECIAL_EXPONENT 0x40000000
+
+// How rounding handles results that are not exactly representable. Same as
+// `rounding_mode` in "metal_float64".
+typedef enum {
+  // Round to nearest, ties to even. Overflows to INF.
+  MF64_ROUND_NEAREST = 0,
+
+  // Round toward zero. Overflows to the largest finite number.
+  MF64_ROUND_TRUNCATE = 1
+} mf64_rounding_mode_t;
+
+// MARK: - Double-Single Arithmetic
+
+// Returns (result, exact error). Requires |a| >= |b|, or a == 0.
+MF64_FUNC mf64_float32x2_t mf64_fast_two_sum(float a, float b)
+{
+  MF64_PRECISE_MATH
+  mf64_float32x2_t output;
+  output.hi = a + b;
+  output.lo = b - (output.hi - a);
+  return output;
+}
+
+MF64_FUNC mf64_float32x2_t mf64_two_sum(float a, float b)
+{
+  MF64_PRECISE_MATH
+  float s = a + b;
+  float b_virtual = s - a;
+  float a_virtual = s - b_virtual;
+  mf64_float32x2_t output;
+  output.hi = s;
+  output.lo = (a - a_virtual) + (b - b_virtual);
+  return output;
+}
+
+MF64_FUNC mf64_float32x2_t mf64_two_prod(float a, float b)
+{
+  mf64_float32x2_t output;
+  output.hi = a * b;
+  output.lo = MF64_FMA(a, b, -output.hi);
+  return output;
+}
+
+// Rounds to 12 significant bits in `hi`, and returns the remainder in `lo`.
+// Both halves fit in 12 bits, so products between them are exact. Truncates
+// instead where rounding up would overflow.
+MF64_FUNC mf64_float32x2_t mf64_split(float x)
+{
+  mf64_uint bits = MF64_AS_UINT(x);
+  mf64_uint rounded = (bits + 0x800u) & 0xFFFFF000u;
+  mf64_float32x2_t output;
+  if ((rounded & 0x7F800000u) == 0x7F800000u) {
+    rounded = bits & 0xFFFFF000u;
+  }
+  output.hi = MF64_AS_FLOAT(rounded);
+  output.lo = x - output.hi;
+  return output;
+}
+
+MF64_FUNC mf64_float32x2_t mf64_float32x2_negate(mf64_float32x2_t x)
+{
+  x.hi = -x.hi;
+  x.lo = -x.lo;
+  return x;
+}
+
+MF64_FUNC mf64_float32x2_t mf64_float32x2_add
+ (
+  mf64_float32x2_t lhs, mf64_float32x2_t rhs)
+{
+  MF64_PRECISE_MATH
+  mf64_float32x2_t sum = mf64_two_sum(lhs.hi, rhs.hi);
+  return mf64_fast_two_sum(sum.hi, sum.lo + (lhs.lo + rhs.lo));
+}
+
+MF64_FUNC mf64_float32x2_t mf64_float32x2_add_float
+ (
+  mf64_float32x2_t lhs, float rhs)
+{
+  MF64_PRECISE_MATH
+  mf64_float32x2_t sum = mf64_two_sum(lhs.hi, rhs);
+  return mf64_fast_two_sum(sum.hi, sum.lo + lhs.lo);
+}
+
+MF64_FUNC mf64_float32x2_t mf64_float32x2_subtract
+ (
+  mf64_float32x2_t lhs, mf64_float32x2_t rhs)
+{
+  return mf64_float32x2_add(lhs, mf64_float32x2_negate(rhs));
+}
+
+// Stays accurate when the inputs cancel, at roughly twice the cost.
+MF64_FUNC mf64_float32x2_t mf64_float32x2_accurate_add
+ (
+  mf64_float32x2_t lhs, mf64_float32x2_t rhs)
+{
+  MF64_PRECISE_MATH
+  mf64_float32x2_t hi = mf64_two_sum(lhs.hi, rhs.hi);
+  mf64_float32x2_t lo = mf64_two_sum(lhs.lo, rhs.lo);
+  mf64_float32x2_t sum = mf64_fast_two_sum(hi.hi, hi.lo + lo.hi);
+  return mf64_fast_two_sum(sum.hi, sum.lo + lo.lo);
+}
+
+MF64_FUNC mf64_float32x2_t mf64_float32x2_multiply
+ (
+  mf64_float32x2_t lhs, mf64_float32x2_t rhs)
+{
+  mf64_float32x2_t product = mf64_two_prod(lhs.hi, rhs.hi);
+  float error = MF64_FMA(lhs.lo, rhs.hi, product.lo);
+  error = MF64_FMA(lhs.hi, rhs.lo, error);
+  return mf64_fast_two_sum(product.hi, error);
+}
+
+MF64_FUNC mf64_float32x2_t mf64_float32x2_multiply_float
+ (
+  mf64_float32x2_t lhs, float rhs)
+{
+  mf64_float32x2_t product = mf64_two_prod(lhs.hi, rhs);
+  float error = MF64_FMA(lhs.lo, rhs, product.lo);
+  return mf64_fast_two_sum(product.hi, error);
+}
+
+// Computes a * b + c, normalizing once instead of twice.
+MF64_FUNC mf64_float32x2_t mf64_float32x2_fma
+ (
+  mf64_float32x2_t a, mf64_float32x2_t b, mf64_float32x2_t c)
+{
+  MF64_PRECISE_MATH
+  mf64_float32x2_t product = mf64_two_prod(a.hi, b.hi);
+  float product_error = MF64_FMA(a.lo, b.hi, product.lo);
+  product_error = MF64_FMA(a.hi, b.lo, product_error);
+  mf64_float32x2_t sum = mf64_two_sum(product.hi, c.hi);
+  return mf64_fast_two_sum(sum.hi, sum.lo + (product_error + c.lo));
+}
+
+// Computes a * b + c, where `c` is a float.
+MF64_FUNC mf64_float32x2_t mf64_float32x2_fma_float
+ (
+  mf64_float32x2_t a, mf64_float32x2_t b, float c)
+{
+  MF64_PRECISE_MATH
+  mf64_float32x2_t product = mf64_two_prod(a.hi, b.hi);
+  float product_error = MF64_FMA(a.lo, b.hi, product.lo);
+  product_error = MF64_FMA(a.hi, b.lo, product_error);
+  mf64_float32x2_t sum = mf64_two_sum(product.hi, c);
+  return mf64_fast_two_sum(sum.hi, sum.lo + product_error);
+}
+
+// Computes a * b + c, where `b` and `c` are floats.
+MF64_FUNC mf64_float32x2_t mf64_float32x2_fma_float_float
+ (
+  mf64_float32x2_t a, float b, float c)
+{
+  MF64_PRECISE_MATH
+  mf64_float32x2_t product = mf64_two_prod(a.hi, b);
+  float product_error = MF64_FMA(a.lo, b, product.lo);
+  mf64_float32x2_t sum = mf64_two_sum(product.hi, c);
+  return mf64_fast_two_sum(sum.hi, sum.lo + product_error);
+}
+
+// MARK: - Unpacking
+
+// Shifts the leading one to bit 61. The mantissa must be below 2^62.
+MF64_FUNC mf64_accum_t mf64_accum_normalize(mf64_accum_t x)
+{
+  mf64_uint shift = (mf64_uint)MF64_CLZ(x.mantissa) - 2;
+  x.mantissa <<= shift;
+  x.exponent = (x.mantissa == 0) ? MF64_ZERO_EXPONENT
+                                 : x.exponent - (int)shift;
+  return x;
+}
+
+MF64_FUNC mf64_accum_t mf64_accum_from_float64(mf64_float64_t x)
+{
+  mf64_uint biased_exponent = (mf64_uint)(x.data >> 52) & 0x7FF;
+  mf64_ulong fraction = x.data & 0x000FFFFFFFFFFFFF;
+  mf64_ulong hidden_bit = (biased_exponent == 0) ? 0 : ((mf64_ulong)1 << 52);
+
+  mf64_accum_t output;
+  output.mantissa = (fraction | hidden_bit) << 9;
+  output.exponent = (biased_exponent == 0 ? 1 : (int)biased_exponent) - 1084;
+  output.sign = (mf64_uint)(x.data >> 32) & 0x80000000;
+  output = mf64_accum_normalize(output);
+#if !defined(METAL_FLOAT64_DISABLE_EDGE_CASES)
+  if (biased_exponent == 2047) {
+    output.mantissa = fraction;
+    output.exponent = MF64_SPECIAL_EXPONENT;
+  }
+#endif
+  return output;
+}
+
+MF64_FUNC mf64_accum_t mf64_accum_from_float(float x)
+{
+  mf64_uint bits = MF64_AS_UINT(x);
+  mf64_uint biased_exponent = (bits >> 23) & 0xFF;
+  mf64_uint fraction = bits & 0x007FFFFF;
+  mf64_uint hidden_bit = (biased_exponent == 0) ? 0 : 0x00800000;
+
+  mf64_accum_t output;
+  output.mantissa = (mf64_ulong)(fraction | hidden_bit) << 38;
+  output.exponent = (biased_exponent == 0 ? 1 : (int)biased_exponent) - 188;
+  output.sign = bits & 0x80000000;
+  output = mf64_accum_normalize(output);
+#if !defined(METAL_FLOAT64_DISABLE_EDGE_CASES)
+  if (biased_exponent == 255) {
+    output.mantissa = (mf64_ulong)fraction << 29;
+    output.exponent = MF64_SPECIAL_EXPONENT;
+  }
+#endif
+  return output;
+}
+
+// MARK: - Rounding
+
+// Rounds to an IEEE-style format with `exponent_bits` exponent bits and
+// `fraction_bits` explicit mantissa bits, then returns its bit pattern. Handles
+// denormals, overflow, INF, and NAN the same way as IEEE `double`.
+MF64_FUNC mf64_ulong mf64_accum_round
+ (
+  mf64_accum_t x, int exponent_bits, int fraction_bits,
+  mf64_rounding_mode_t mode)
+{
+  int bias = (1 << (exponent_bits - 1)) - 1;
+  mf64_ulong infinity =
+    (mf64_ulong)((1 << exponent_bits) - 1) << fraction_bits;
+
+  // Denormal results shift further right, until their exponent reaches the
+  // minimum. Results too small for a denormal shift out entirely.
+  int biased_exponent = x.exponent + 61 + bias;
+  int clamped_exponent = (biased_exponent < 1) ? 1 : biased_exponent;
+  int denormal_shift = clamped_exponent - biased_exponent;
+  int unclamped_shift = 61 - fraction_bits + denormal_shift;
+  mf64_uint shift = (mf64_uint)(unclamped_shift < 63 ? unclamped_shift : 63);
+
+  mf64_ulong truncated = x.mantissa >> shift;
+  mf64_ulong remainder = x.mantissa & (((mf64_ulong)1 << shift) - 1);
+  mf64_ulong halfway = (mf64_ulong)1 << (shift - 1);
+  int round_up = (remainder > halfway) ||
+    (remainder == halfway && (truncated & 1));
+  if (mode == MF64_ROUND_TRUNCATE) {
+    round_up = 0;
+  }
+
+  // The leading one carries into the exponent field, which also handles
+  // rounding up to the next binade.
+  mf64_ulong bits =
+    ((mf64_ulong)(clamped_exponent - 1) << fraction_bits) + truncated;
+  bits += (mf64_ulong)round_up;
+#if !defined(METAL_FLOAT64_DISABLE_EDGE_CASES)
+  if (biased_exponent >= (int)(infinity >> fraction_bits)) {
+    int saturate = (mode == MF64_ROUND_TRUNCATE) &&
+      (x.exponent != MF64_SPECIAL_EXPONENT);
+    bits = saturate ? infinity - 1 : infinity;
+  }
+  if (x.exponent == MF64_SPECIAL_EXPONENT && x.mantissa != 0) {
+    mf64_ulong payload = x.mantissa >> (52 - fraction_bits);
+    bits = infinity | ((mf64_ulong)1 << (fraction_bits - 1)) | payload;
+  }
+#endif
+  return bits | ((mf64_ulong)(x.sign >> 31) << (exponent_bits + fraction_bits));
+}
+
+MF64_FUNC mf64_float64_t mf64_accum_to_float64(mf64_accum_t x)
+{
+  mf64_float64_t output;
+  output.data = mf64_accum_round(x, 11, 52, MF64_ROUND_NEAREST);
+  return output;
+}
+
+MF64_FUNC float mf64_accum_to_float(mf64_accum_t x)
+{
+  return MF64_AS_FLOAT(
+    (mf64_uint)mf64_accum_round(x, 8, 23, MF64_ROUND_NEAREST));
+}
+
+// MARK: - Accumulator Arithmetic
+
+MF64_FUNC mf64_accum_t mf64_accum_negate(mf64_accum_t x)
+{
+  x.sign ^= 0x80000000;
+  return x;
+}
+
+// Shifts right, jamming any bits that shift out into bit 0. The input must be
+// below 2^63.
+MF64_FUNC mf64_ulong mf64_shift_right_jam(mf64_ulong x, mf64_uint distance)
+{
+  mf64_uint clamped = (distance < 63) ? distance : 63;
+  mf64_ulong lost = x & (((mf64_ulong)1 << clamped) - 1);
+  return (x >> clamped) | (mf64_ulong)(lost != 0);
+}
+
+MF64_FUNC mf64_accum_t mf64_accum_nan(void)
+{
+  mf64_accum_t output;
+  output.mantissa = (mf64_ulong)1 << 51;
+  output.exponent = MF64_SPECIAL_EXPONENT;
+  output.sign = 0;
+  return output;
+}
+
+// Called when at least one operand is INF or NAN.
+MF64_FUNC mf64_accum_t mf64_accum_special_add(mf64_accum_t a, mf64_accum_t b)
+{
+  if (a.exponent == MF64_SPECIAL_EXPONENT && a.mantissa != 0) {
+    return a;
+  }
+  if (b.exponent == MF64_SPECIAL_EXPONENT && b.mantissa != 0) {
+    return b;
+  }
+  if (a.exponent == b.exponent && a.sign != b.sign) {
+    return mf64_accum_nan();
+  }
+  return (a.exponent == MF64_SPECIAL_EXPONENT) ? a : b;
+}
+
+// Called when at least one operand is INF or NAN.
+MF64_FUNC mf64_accum_t mf64_accum_special_multiply
+ (
+  mf64_accum_t a, mf64_accum_t b)
+{
+  if (a.exponent == MF64_SPECIAL_EXPONENT && a.mantissa != 0) {
+    return a;
+  }
+  if (b.exponent == MF64_SPECIAL_EXPONENT && b.mantissa != 0) {
+    return b;
+  }
+  if (a.exponent == MF64_ZERO_EXPONENT || b.exponent == MF64_ZERO_EXPONENT) {
+    return mf64_accum_nan();
+  }
+
+  mf64_accum_t output;
+  output.mantissa = 0;
+  output.exponent = MF64_SPECIAL_EXPONENT;
+  output.sign = a.sign ^ b.sign;
+  return output;
+}
+
+MF64_FUNC mf64_accum_t mf64_accum_add(mf64_accum_t a, mf64_accum_t b)
+{
+#if !defined(METAL_FLOAT64_DISABLE_EDGE_CASES)
+  if (a.exponent == MF64_SPECIAL_EXPONENT ||
+      b.exponent == MF64_SPECIAL_EXPONENT) {
+    return mf64_accum_special_add(a, b);
+  }
+#endif
+
+  // Both operands are normalized, so the larger exponent also means the
+  // larger magnitude (except when the exponents are equal).
+  if (a.exponent < b.exponent) {
+    mf64_accum_t temp = a;
+    a = b;
+    b = temp;
+  }
+  mf64_ulong aligned = mf64_shift_right_jam(
+    b.mantissa, (mf64_uint)(a.exponent - b.exponent));
+
+  mf64_accum_t output;
+  output.exponent = a.exponent;
+  output.sign = a.sign;
+  if (a.sign == b.sign) {
+    // The sum is below 2^63, so at most one bit shifts out.
+    mf64_ulong sum = a.mantissa + aligned;
+    mf64_uint carry = (mf64_uint)(sum >> 62);
+    output.mantissa = (sum >> carry) | (sum & carry);
+    output.exponent += (int)carry;
+  } else {
+    if (aligned > a.mantissa) {
+      output.mantissa = aligned - a.mantissa;
+      output.sign = b.sign;
+    } else {
+      output.mantissa = a.mantissa - aligned;
+    }
+
+    // Exact cancellation produces +0 when rounding to nearest.
+    if (output.mantissa == 0) {
+      output.sign = 0;
+    }
+    output = mf64_accum_normalize(output);
+  }
+  return output;
+}
+
+MF64_FUNC mf64_accum_t mf64_accum_subtract(mf64_accum_t a, mf64_accum_t b)
+{
+  return mf64_accum_add(a, mf64_accum_negate(b));
+}
+
+MF64_FUNC mf64_accum_t mf64_accum_multiply(mf64_accum_t a, mf64_accum_t b)
+{
+#if !defined(METAL_FLOAT64_DISABLE_EDGE_CASES)
+  if (a.exponent == MF64_SPECIAL_EXPONENT ||
+      b.exponent == MF64_SPECIAL_EXPONENT) {
+    return mf64_accum_special_multiply(a, b);
+  }
+#endif
+
+  // Both mantissas lie in [2^61, 2^62), so the 124-bit product's leading one
+  // sits at bit 122 or 123. Shift it back to bit 61.
+  mf64_ulong product_hi = MF64_MULHI(a.mantissa, b.mantissa);
+  mf64_ulong product_lo = a.mantissa * b.mantissa;
+  mf64_uint shift = (mf64_uint)MF64_CLZ(product_hi) - 2;
+
+  mf64_accum_t output;
+  output.mantissa = (product_hi << shift) | (product_lo >> (64 - shift));
+  output.mantissa |= (mf64_ulong)((product_lo << shift) != 0);
+  output.exponent = a.exponent + b.exponent + 64 - (int)shift;
+  output.sign = a.sign ^ b.sign;
+
+  if (output.mantissa == 0) {
+    output.exponent = MF64_ZERO_EXPONENT;
+  }
+  return output;
+}
+
+// The FP64*FP32 path. The float's mantissa only has 24 bits, so the product
+// takes two 32-bit multiplies instead of a full 64-bit `mulhi`.
+MF64_FUNC mf64_accum_t mf64_accum_multiply_float(mf64_accum_t a, float b)
+{
+  mf64_accum_t b_unpacked = mf64_accum_from_float(b);
+#if !defined(METAL_FLOAT64_DISABLE_EDGE_CASES)
+  if (a.exponent == MF64_SPECIAL_EXPONENT ||
+      b_unpacked.exponent == MF64_SPECIAL_EXPONENT) {
+    return mf64_accum_special_multiply(a, b_unpacked);
+  }
+#endif
+
+  // The 86-bit product's leading one sits at bit 84 or 85, which is bit 52 or
+  // 53 of the upper part. Shift it to bit 61.
+  mf64_ulong b_mantissa = b_unpacked.mantissa >> 38;
+  mf64_ulong product_lo = (a.mantissa & 0xFFFFFFFF) * b_mantissa;
+  mf64_ulong product_hi = (a.mantissa >> 32) * b_mantissa + (product_lo >> 32);
+  mf64_uint lower_word = (mf64_uint)product_lo;
+  mf64_uint clz_shift = (mf64_uint)MF64_CLZ(product_hi) - 2;
+  mf64_uint shift = (clz_shift < 31) ? clz_shift : 31;
+
+  mf64_accum_t output;
+  output.mantissa = (product_hi << shift) | (lower_word >> (32 - shift));
+  output.mantissa |= (mf64_ulong)((mf64_uint)(lower_word << shift) != 0);
+  output.exponent = a.exponent + b_unpacked.exponent + 70 - (int)shift;
+  output.sign = a.sign ^ b_unpacked.sign;
+
+  if (output.mantissa == 0) {
+    output.exponent = MF64_ZERO_EXPONENT;
+  }
+  return output;
+}
+
+// MARK: - IEEE Double Arithmetic
+
+// Each function unpacks, operates in the accumulator format, then rounds once.
+// The results are correctly rounded.
+
+MF64_FUNC mf64_float64_t mf64_float64_negate(mf64_float64_t x)
+{
+  x.data ^= 0x8000000000000000;
+  return x;
+}
+
+MF64_FUNC mf64_float64_t mf64_float64_add
+ (
+  mf64_float64_t lhs, mf64_float64_t rhs)
+{
+  return mf64_accum_to_float64(mf64_accum_add(
+    mf64_accum_from_float64(lhs), mf64_accum_from_float64(rhs)));
+}
+
+MF64_FUNC mf64_float64_t mf64_float64_subtract
+ (
+  mf64_float64_t lhs, mf64_float64_t rhs)
+{
+  return mf64_accum_to_float64(mf64_accum_subtract(
+    mf64_accum_from_float64(lhs), mf64_accum_from_float64(rhs)));
+}
+
+MF64_FUNC mf64_float64_t mf64_float64_multiply
+ (
+  mf64_float64_t lhs, mf64_float64_t rhs)
+{
+  return mf64_accum_to_float64(mf64_accum_multiply(
+    mf64_accum_from_float64(lhs), mf64_accum_from_float64(rhs)));
+}
+
+// MARK: - Error-Free Transformations
+
+// The same algorithms as "ErrorFree.h". Every step after the first rounding is
+// exact, so the results match IEEE `double` for finite inputs that do not
+// overflow, except possibly in the sign of a zero error.
+
+// Requires |a| >= |b|, or a == 0.
+MF64_FUNC mf64_float64x2_t mf64_float64_fast_two_sum
+ (
+  mf64_float64_t a, mf64_float64_t b)
+{
+  mf64_accum_t a_unpacked = mf64_accum_from_float64(a);
+  mf64_accum_t b_unpacked = mf64_accum_from_float64(b);
+  mf64_accum_t difference;
+  mf64_float64x2_t output;
+  output.hi = mf64_accum_to_float64(mf64_accum_add(a_unpacked, b_unpacked));
+  difference = mf64_accum_subtract(
+    mf64_accum_from_float64(output.hi), a_unpacked);
+  output.lo = mf64_accum_to_float64(
+    mf64_accum_subtract(b_unpacked, difference));
+  return output;
+}
+
+MF64_FUNC mf64_float64x2_t mf64_float64_two_sum
+ (
+  mf64_float64_t a, mf64_float64_t b)
+{
+  if ((a.data << 1) < (b.data << 1)) {
+    mf64_float64_t temp = a;
+    a = b;
+    b = temp;
+  }
+  return mf64_float64_fast_two_sum(a, b);
+}
+
+// Rounds to 26 significant bits in `hi`, and returns the remainder in `lo`.
+// Truncates instead where rounding up would overflow.
+MF64_FUNC mf64_float64x2_t mf64_float64_split(mf64_float64_t x)
+{
+  mf64_ulong mask = ~(((mf64_ulong)1 << 27) - 1);
+  mf64_ulong exponent_mask = 0x7FF0000000000000;
+  mf64_float64x2_t output;
+  output.hi.data = (x.data + ((mf64_ulong)1 << 26)) & mask;
+  if ((output.hi.data & exponent_mask) == exponent_mask) {
+    output.hi.data = x.data & mask;
+  }
+  output.lo = mf64_float64_subtract(x, output.hi);
+  return output;
+}
+
+// Splits the unpacked mantissa into its upper 26 and lower 27 bits, without
+// rounding, so products between the halves are exact.
+MF64_FUNC mf64_accum_t mf64_accum_split_hi(mf64_accum_t x)
+{
+  x.mantissa &= ~(((mf64_ulong)1 << 36) - 1);
+  return x;
+}
+
+MF64_FUNC mf64_accum_t mf64_accum_split_lo(mf64_accum_t x)
+{
+  x.mantissa &= ((mf64_ulong)1 << 36) - 1;
+  return mf64_accum_normalize(x);
+}
+
+// Dekker's product, split and summed in the accumulator format, which never
+// overflows.
+MF64_FUNC mf64_float64x2_t mf64_float64_two_prod
+ (
+  mf64_float64_t a, mf64_float64_t b)
+{
+  mf64_accum_t a_unpacked = mf64_accum_from_float64(a);
+  mf64_accum_t b_unpacked = mf64_accum_from_float64(b);
+  mf64_accum_t a_hi = mf64_accum_split_hi(a_unpacked);
+  mf64_accum_t a_lo = mf64_accum_split_lo(a_unpacked);
+  mf64_accum_t b_hi = mf64_accum_split_hi(b_unpacked);
+  mf64_accum_t b_lo = mf64_accum_split_lo(b_unpacked);
+  mf64_accum_t sum;
+  mf64_float64x2_t output;
+  output.hi = mf64_accum_to_float64(
+    mf64_accum_multiply(a_unpacked, b_unpacked));
+
+  sum = mf64_accum_subtract(
+    mf64_accum_multiply(a_hi, b_hi), mf64_accum_from_float64(output.hi));
+  sum = mf64_accum_add(sum, mf64_accum_multiply(a_hi, b_lo));
+  sum = mf64_accum_add(sum, mf64_accum_multiply(a_lo, b_hi));
+  sum = mf64_accum_add(sum, mf64_accum_multiply(a_lo, b_lo));
+  output.lo = mf64_accum_to_float64(sum);
+  return output;
+}
+
+// MARK: - Conversions
+
+// The same conversions as `convert<T, Mode>` in "metal_float64". Results are
+// correctly rounded in the chosen mode, so they match CPU casts bit for bit.
+// Integer results saturate when out of range, and NAN becomes 0. `half` is
+// passed as its bit pattern, because C has no such type.
+
+// Every input fits in `mf64_accum_t` without rounding, except `long` and
+// `mf64_float32x2_t` which may exceed 62 bits. Those jam the extra bits into
+// bit 0, which still rounds correctly to any output with 53 bits or fewer.
+MF64_FUNC mf64_accum_t mf64_accum_from_long(mf64_long x)
+{
+  // Negating in unsigned arithmetic also handles the most negative number.
+  mf64_ulong magnitude = (x < 0) ? 0 - (mf64_ulong)x : (mf64_ulong)x;
+  int shift = (int)MF64_CLZ(magnitude) - 2;
+
+  mf64_accum_t output;
+  if (shift >= 0) {
+    output.mantissa = magnitude << shift;
+  } else {
+    mf64_ulong lost = magnitude & (((mf64_ulong)1 << -shift) - 1);
+    output.mantissa = (magnitude >> -shift) | (mf64_ulong)(lost != 0);
+  }
+  output.exponent = -shift;
+  output.sign = (x < 0) ? 0x80000000 : 0;
+
+  if (magnitude == 0) {
+    output.exponent = MF64_ZERO_EXPONENT;
+  }
+  return output;
+}
+
+MF64_FUNC mf64_accum_t mf64_accum_from_float32x2(mf64_float32x2_t x)
+{
+  return mf64_accum_add(
+    mf64_accum_from_float(x.hi), mf64_accum_from_float(x.lo));
+}
+
+// Widening from `half` is exact, including denormals, INF, and NAN payloads.
+MF64_FUNC float mf64_half_to_float(mf64_ushort x)
+{
+  mf64_uint sign = (mf64_uint)(x & 0x8000) << 16;
+  mf64_uint biased_exponent = (x >> 10) & 0x1F;
+  mf64_uint fraction = x & 0x3FF;
+  mf64_uint bits = sign | ((biased_exponent + 112) << 23) | (fraction << 13);
+  if (biased_exponent == 31) {
+    bits = sign | 0x7F800000 | (fraction << 13);
+  }
+  if (biased_exponent == 0) {
+    // Denormals are `fraction * 2^-24`, which `float` holds exactly.
+    bits = sign | MF64_AS_UINT((float)fraction * 5.9604644775390625e-8f);
+  }
+  return MF64_AS_FLOAT(bits);
+}
+
+MF64_FUNC mf64_long mf64_accum_to_integer
+ (
+  mf64_accum_t x, int magnitude_bits, mf64_rounding_mode_t mode)
+{
+  mf64_ulong magnitude;
+  mf64_ulong limit;
+  mf64_long output;
+  if (x.exponent >= 2) {
+    // At least 2^63, which saturates below.
+    magnitude = (mf64_ulong)1 << 63;
+  } else if (x.exponent >= 0) {
+    magnitude = x.mantissa << x.exponent;
+  } else {
+    mf64_uint shift = (mf64_uint)(-x.exponent < 63 ? -x.exponent : 63);
+    mf64_ulong truncated = x.mantissa >> shift;
+    mf64_ulong remainder = x.mantissa & (((mf64_ulong)1 << shift) - 1);
+    mf64_ulong halfway = (mf64_ulong)1 << (shift - 1);
+    int round_up = (remainder > halfway) ||
+      (remainder == halfway && (truncated & 1));
+    if (mode == MF64_ROUND_TRUNCATE) {
+      round_up = 0;
+    }
+    magnitude = truncated + (mf64_ulong)round_up;
+  }
+
+  // Saturate to [-2^magnitude_bits, 2^magnitude_bits - 1].
+  limit = ((mf64_ulong)1 << magnitude_bits) - ((x.sign == 0) ? 1 : 0);
+  magnitude = (magnitude < limit) ? magnitude : limit;
+  output = (x.sign == 0) ? (mf64_long)magnitude
+                         : (mf64_long)(0 - magnitude);
+#if !defined(METAL_FLOAT64_DISABLE_EDGE_CASES)
+  if (x.exponent == MF64_SPECIAL_EXPONENT && x.mantissa != 0) {
+    output = 0;
+  }
+#endif
+  return output;
+}
+
+// Rounds the upper half, then rounds the remainder into the lower half. Values
+// outside the range of `float` are undefined.
+MF64_FUNC mf64_float32x2_t mf64_accum_to_float32x2
+ (
+  mf64_accum_t x, mf64_rounding_mode_t mode)
+{
+  mf64_float32x2_t output;
+  output.hi = MF64_AS_FLOAT((mf64_uint)mf64_accum_round(x, 8, 23, mode));
+  output.lo = MF64_AS_FLOAT((mf64_uint)mf64_accum_round(
+    mf64_accum_subtract(x, mf64_accum_from_float(output.hi)), 8, 23, mode));
+  return output;
+}
+
+// Clears the lowest `dropped_bits` of a `double`'s mantissa. When rounding to
+// nearest, the carry propagates into the exponent, which also handles rounding
+// up to the next binade or to INF.
+MF64_FUNC mf64_ulong mf64_float64_narrow_bits
+ (
+  mf64_ulong bits, int dropped_bits, mf64_rounding_mode_t mode)
+{
+  mf64_ulong mask = ((mf64_ulong)1 << dropped_bits) - 1;
+  mf64_ulong output = bits;
+  if (mode == MF64_ROUND_NEAREST) {
+    output += (mask >> 1) + ((bits >> dropped_bits) & 1);
+  }
+#if !defined(METAL_FLOAT64_DISABLE_EDGE_CASES)
+  // Keep NANs from rounding into INF, or carrying into the sign bit.
+  if ((bits & 0x7FFFFFFFFFFFFFFF) > 0x7FF0000000000000) {
+    output = bits | 0x0008000000000000;
+  }
+#endif
+  return output & ~mask;
+}
+
+// Normal numbers only need their exponent rebiased.
+MF64_FUNC mf64_float64_t mf64_float64_from_float(float x)
+{
+  mf64_uint bits = MF64_AS_UINT(x);
+  mf64_uint biased_exponent = (bits >> 23) & 0xFF;
+  int slow_path;
+  mf64_float64_t output;
+  output.data = ((mf64_ulong)(bits & 0x7FFFFFFF) << 29) +
+    ((mf64_ulong)(1023 - 127) << 52);
+  output.data |= (mf64_ulong)(bits & 0x80000000) << 32;
+
+#if defined(METAL_FLOAT64_DISABLE_EDGE_CASES)
+  slow_path = (biased_exponent == 0);
+#else
+  slow_path = (biased_exponent == 0) || (biased_exponent == 255);
+#endif
+  if (slow_path) {
+    output = mf64_accum_to_float64(mf64_accum_from_float(x));
+  }
+  return output;
+}
+
+MF64_FUNC float mf64_float64_to_float
+ (
+  mf64_float64_t x, mf64_rounding_mode_t mode)
+{
+  return MF64_AS_FLOAT((mf64_uint)mf64_accum_round(
+    mf64_accum_from_float64(x), 8, 23, mode));
+}
+
+MF64_FUNC mf64_float64_t mf64_float64_from_half(mf64_ushort x)
+{
+  return mf64_float64_from_float(mf64_half_to_float(x));
+}
+
+MF64_FUNC mf64_ushort mf64_float64_to_half
+ (
+  mf64_float64_t x, mf64_rounding_mode_t mode)
+{
+  return (mf64_ushort)mf64_accum_round(
+    mf64_accum_from_float64(x), 5, 10, mode);
+}
+
+MF64_FUNC mf64_float64_t mf64_float64_from_long(mf64_long x)
+{
+  return mf64_accum_to_float64(mf64_accum_from_long(x));
+}
+
+MF64_FUNC mf64_long mf64_float64_to_long
+ (
+  mf64_float64_t x, mf64_rounding_mode_t mode)
+{
+  return mf64_accum_to_integer(mf64_accum_from_float64(x), 63, mode);
+}
+
+MF64_FUNC mf64_float64_t mf64_float64_from_int(int x)
+{
+  return mf64_float64_from_long(x);
+}
+
+MF64_FUNC int mf64_float64_to_int
+ (
+  mf64_float64_t x, mf64_rounding_mode_t mode)
+{
+  return (int)mf64_accum_to_integer(mf64_accum_from_float64(x), 31, mode);
+}
+
+MF64_FUNC mf64_float64_t mf64_float64_from_float32x2(mf64_float32x2_t x)
+{
+  return mf64_accum_to_float64(mf64_accum_from_float32x2(x));
+}
+
+MF64_FUNC mf64_float32x2_t mf64_float64_to_float32x2
+ (
+  mf64_float64_t x, mf64_rounding_mode_t mode)
+{
+  return mf64_accum_to_float32x2(mf64_accum_from_float64(x), mode);
+}
+
+// Widening to `mf64_float64_t` is exact.
+MF64_FUNC mf64_float64_t mf64_float64_from_float59(mf64_float59_t x)
+{
+  mf64_float64_t output;
+  output.data = x.data;
+  return output;
+}
+
+MF64_FUNC mf64_float59_t mf64_float64_to_float59
+ (
+  mf64_float64_t x, mf64_rounding_mode_t mode)
+{
+  mf64_float59_t output;
+  output.data = mf64_float64_narrow_bits(x.data, 5, mode);
+  return output;
+}
+
+MF64_FUNC mf64_float64_t mf64_float64_from_float43(mf64_float43_t x)
+{
+  mf64_float64_t output;
+  output.data = x.data;
+  return output;
+}
+
+MF64_FUNC mf64_float43_t mf64_float64_to_float43
+ (
+  mf64_float64_t x, mf64_rounding_mode_t mode)
+{
+  mf64_float43_t output;
+  output.data = mf64_float64_narrow_bits(x.data, 21, mode);
+  return output;
+}
+
+#endif /* MetalFloat64Core_h */
@@ -0,0 +1,8 @@
+//
+//  MetalFloat64Core.c
+//  MetalFloat64
+//
+
+// SwiftPM needs at least one source file per C target. Every function is
+// defined inline in the header.
+#include "MetalFloat64Core/MetalFloat64Core.h"
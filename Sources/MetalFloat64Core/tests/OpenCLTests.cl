@@ -0,0 +1,74 @@
+//
+//  OpenCLTests.cl
+//  MetalFloat64
+//
+
+#include <MetalFloat64Core/MetalFloat64Core.h>
+
+// Calls every function through the OpenCL branch of the core. The build script
+// only type-checks this file, because it has no OpenCL device to run it on.
+__kernel void testCore
+ (
+  __global const ulong *input64,
+  __global const float *input32,
+  __global ulong *output64,
+  __global float *output32)
+{
+  uint tid = (uint)get_global_id(0);
+  mf64_float64_t a, b;
+  a.data = input64[2 * tid];
+  b.data = input64[2 * tid + 1];
+  float c = input32[2 * tid];
+  float d = input32[2 * tid + 1];
+
+  // float64_t
+  mf64_float64_t sum = mf64_float64_add(a, b);
+  mf64_float64_t difference = mf64_float64_subtract(a, mf64_float64_negate(b));
+  mf64_float64_t product = mf64_float64_multiply(sum, difference);
+
+  // Accumulator
+  mf64_accum_t accum = mf64_accum_from_float64(product);
+  accum = mf64_accum_multiply(accum, mf64_accum_from_float(c));
+  accum = mf64_accum_multiply_float(accum, d);
+  accum = mf64_accum_add(accum, mf64_accum_from_float64(a));
+  output64[4 * tid] = mf64_accum_to_float64(accum).data;
+  output64[4 * tid + 1] = mf64_accum_round(accum, 11, 31, MF64_ROUND_TRUNCATE);
+
+  // Error-free transformations
+  mf64_float64x2_t eft = mf64_float64_two_prod(a, b);
+  eft = mf64_float64_two_sum(eft.hi, eft.lo);
+  eft = mf64_float64_fast_two_sum(eft.hi, eft.lo);
+  eft = mf64_float64_split(eft.hi);
+  output64[4 * tid + 2] = eft.hi.data;
+  output64[4 * tid + 3] = eft.lo.data;
+
+  // float32x2_t
+  mf64_float32x2_t x = mf64_float64_to_float32x2(a, MF64_ROUND_NEAREST);
+  mf64_float32x2_t y = mf64_two_prod(c, d);
+  y = mf64_float32x2_add(y, mf64_two_sum(c, d));
+  y = mf64_float32x2_add_float(y, mf64_fast_two_sum(c, d).lo);
+  y = mf64_float32x2_subtract(y, mf64_split(c));
+  y = mf64_float32x2_accurate_add(x, y);
+  y = mf64_float32x2_multiply(x, y);
+  y = mf64_float32x2_multiply_float(y, c);
+  y = mf64_float32x2_fma(x, y, mf64_float32x2_negate(x));
+  y = mf64_float32x2_fma_float(x, y, c);
+  y = mf64_float32x2_fma_float_float(y, c, d);
+  output32[2 * tid] = y.hi;
+  output32[2 * tid + 1] = mf64_float64_to_float(
+    mf64_float64_from_float32x2(y), MF64_ROUND_TRUNCATE);
+
+  // Conversions
+  mf64_float59_t float59 = mf64_float64_to_float59(a, MF64_ROUND_NEAREST);
+  mf64_float43_t float43 = mf64_float64_to_float43(b, MF64_ROUND_TRUNCATE);
+  mf64_float64_t widened = mf64_float64_add(
+    mf64_float64_from_float59(float59), mf64_float64_from_float43(float43));
+  widened = mf64_float64_add(widened, mf64_float64_from_float(c));
+  widened = mf64_float64_add(widened, mf64_float64_from_half(
+    mf64_float64_to_half(a, MF64_ROUND_NEAREST)));
+  widened = mf64_float64_add(widened, mf64_float64_from_int(
+    mf64_float64_to_int(b, MF64_ROUND_TRUNCATE)));
+  widened = mf64_float64_add(widened, mf64_float64_from_long(
+    mf64_float64_to_long(a, MF64_ROUND_NEAREST)));
+  output64[4 * tid + 3] ^= widened.data;
+}
@@ -0,0 +1,521 @@
+import XCTest
+import MetalFloat64Core
+
+// Runs the portable core on the host. Unlike "MetalFloat64Tests", this does
+// not need a GPU, so it also runs on Linux.
+final class CoreTests: XCTestCase {
+  // The emulated operations are correctly rounded, so they should match the
+  // CPU bit for bit.
+  func testFloat64Arithmetic() throws {
+    for _ in 0..<(1 << 20) {
+      let a = generateCoreInput()
+      let b = generateCoreInput()
+      let lhs = mf64_float64_t(data: a.bitPattern)
+      let rhs = mf64_float64_t(data: b.bitPattern)
+
+      let results = [
+        (mf64_float64_add(lhs, rhs), a + b, "+"),
+        (mf64_float64_subtract(lhs, rhs), a - b, "-"),
+        (mf64_float64_multiply(lhs, rhs), a * b, "*"),
+      ]
+      for (actual, expected, name) in results {
+        let actual = Double(bitPattern: actual.data)
+        guard same(actual, expected) else {
+          XCTFail("\(a) \(name) \(b): \(expected) != \(actual)")
+          return
+        }
+      }
+    }
+  }
+
+  // Conversions should match native casts in both rounding modes. Integer
+  // conversions saturate and turn NAN into 0, where native casts would trap.
+  func testConversions() throws {
+    let nearest = MF64_ROUND_NEAREST
+    let truncate = MF64_ROUND_TRUNCATE
+
+    for _ in 0..<(1 << 20) {
+      let x = generateCoreInput()
+      let float = Float(x)
+      let packed = mf64_float64_t(data: x.bitPattern)
+
+      let widened = mf64_float64_from_float(float)
+      guard same(Double(bitPattern: widened.data), Double(float)),
+            same(mf64_float64_to_float(packed, nearest), float),
+            same(mf64_float64_to_float(packed, truncate),
+                 roundTowardZero(x, Float(x))) else {
+        XCTFail("Converting \(x) to and from float")
+        return
+      }
+
+      #if !(os(macOS) && arch(x86_64))
+      // `Float16` is unavailable on Intel Macs.
+      let half = Float16(x)
+      let halfNearest = mf64_float64_to_half(packed, nearest)
+      let halfTruncated = mf64_float64_to_half(packed, truncate)
+      let halfWidened = mf64_float64_from_half(half.bitPattern)
+      guard same(Float16(bitPattern: halfNearest), half),
+            same(Float16(bitPattern: halfTruncated),
+                 roundTowardZero(x, Float16(x))),
+            same(Double(bitPattern: halfWidened.data), Double(half)) else {
+        XCTFail("Converting \(x) to and from half")
+        return
+      }
+      #endif
+
+      let long = saturatingInteger(x, nearest: true, as: Int64.self)
+      let longTruncated = saturatingInteger(x, nearest: false, as: Int64.self)
+      let int = saturatingInteger(x, nearest: true, as: Int32.self)
+      let intTruncated = saturatingInteger(x, nearest: false, as: Int32.self)
+      let bits = x.bitPattern
+      let longWidened = mf64_float64_from_long(Int64(bitPattern: bits))
+      let intWidened = mf64_float64_from_int(Int32(truncatingIfNeeded: bits))
+      guard mf64_float64_to_long(packed, nearest) == long,
+            mf64_float64_to_long(packed, truncate) == longTruncated,
+            mf64_float64_to_int(packed, nearest) == int,
+            mf64_float64_to_int(packed, truncate) == intTruncated,
+            longWidened.data == Double(Int64(bitPattern: bits)).bitPattern,
+            intWidened.data ==
+              Double(Int32(truncatingIfNeeded: bits)).bitPattern else {
+        XCTFail("Converting \(x) to and from integers")
+        return
+      }
+
+      for (fractionBits, truncating) in [(47, false), (47, true),
+                                         (31, false), (31, true)] {
+        let mode = truncating ? truncate : nearest
+        let actual = (fractionBits == 47)
+          ? mf64_float64_to_float59(packed, mode).data
+          : mf64_float64_to_float43(packed, mode).data
+        let expected = roundFraction(
+          x, bits: fractionBits, truncating: truncating)
+        guard same(Double(bitPattern: actual), expected) else {
+          XCTFail("Rounding \(x) to \(fractionBits) fraction bits")
+          return
+        }
+      }
+      let float59 = mf64_float59_t(data: bits & ~0x1F)
+      let float43 = mf64_float43_t(data: bits & ~0x1F_FFFF)
+      guard mf64_float64_from_float59(float59).data == float59.data,
+            mf64_float64_from_float43(float43).data == float43.data else {
+        XCTFail("Widening \(x) from float59_t and float43_t")
+        return
+      }
+
+      // The double-single format only covers the range of normal floats.
+      if abs(x) > 0x1p-100 && abs(x) < 0x1p100 {
+        let pair = mf64_float64_to_float32x2(packed, nearest)
+        let lo = Float(x - Double(float))
+        let roundTrip = mf64_float64_from_float32x2(pair)
+        let widened = Double(pair.hi) + Double(pair.lo)
+        let truncatedHi = roundTowardZero(x, float)
+        let truncatedLo = x - Double(truncatedHi)
+        let truncatedPair = mf64_float64_to_float32x2(packed, truncate)
+        guard pair.hi == float, pair.lo == lo,
+              roundTrip.data == widened.bitPattern,
+              truncatedPair.hi == truncatedHi,
+              truncatedPair.lo ==
+                roundTowardZero(truncatedLo, Float(truncatedLo)) else {
+          XCTFail("Converting \(x) to and from float32x2_t")
+          return
+        }
+      }
+    }
+  }
+
+  // The double-single operators are not correctly rounded, so allow error
+  // relative to the operands.
+  func testFloat32x2Arithmetic() throws {
+    func split(_ x: Double) -> mf64_float32x2_t {
+      mf64_float64_to_float32x2(
+        mf64_float64_t(data: x.bitPattern), MF64_ROUND_NEAREST)
+    }
+    func widen(_ x: mf64_float32x2_t) -> Double {
+      Double(x.hi) + Double(x.lo)
+    }
+
+    for i in 0..<(1 << 20) {
+      let a = widen(split(.random(in: -1...1)))
+      var b = widen(split(.random(in: -1...1) * 0x1p10))
+      let c = widen(split(.random(in: -1...1)))
+      if i % 4 == 0 {
+        // Nearly cancelling inputs
+        b = widen(split(-a * (1 + 0x1p-30)))
+      }
+      let scale = max(abs(a), abs(b), abs(c)) * max(1, abs(b))
+
+      let results = [
+        (mf64_float32x2_add(split(a), split(b)), a + b, 0x1p-43),
+        (mf64_float32x2_subtract(split(a), split(b)), a - b, 0x1p-43),
+        (mf64_float32x2_accurate_add(split(a), split(b)), a + b, 0x1p-46),
+        (mf64_float32x2_multiply(split(a), split(b)), a * b, 0x1p-44),
+        (mf64_float32x2_fma(split(a), split(b), split(c)), a * b + c, 0x1p-43),
+      ]
+      for (j, (actual, expected, tolerance)) in results.enumerated() {
+        guard abs(widen(actual) - expected) <= tolerance * scale else {
+          XCTFail("Operation \(j) at (\(a), \(b), \(c)): \(expected) != \(widen(actual))")
+          return
+        }
+      }
+    }
+  }
+
+  // The error-free transformations should match the classic algorithms in
+  // native `Double` and `Float`, except for the sign of a zero error. Inputs
+  // cover the entire finite range, including values near the largest finite
+  // number, where splitting truncates instead of rounding up.
+  func testErrorFreeTransforms() throws {
+    func pack(_ x: Double) -> mf64_float64_t {
+      mf64_float64_t(data: x.bitPattern)
+    }
+    func unpack(_ x: mf64_float64x2_t) -> (Double, Double) {
+      (Double(bitPattern: x.hi.data), Double(bitPattern: x.lo.data))
+    }
+
+    // Knuth's algorithm, which overflows in intermediate steps when both
+    // inputs are near the largest finite number. There, scaling by a power of
+    // two is exact.
+    func twoSum<T: BinaryFloatingPoint>(_ a: T, _ b: T) -> (T, T) {
+      let sum = a + b
+      let bVirtual = sum - a
+      let aVirtual = sum - bVirtual
+      let error = (a - aVirtual) + (b - bVirtual)
+      if error.isFinite {
+        return (sum, error)
+      }
+      return (sum, 4 * twoSum(a / 4, b / 4).1)
+    }
+
+    for i in 0..<(1 << 20) {
+      var a = generateCoreInput()
+      var b = generateCoreInput()
+      if i % 8 == 0 {
+        a = generateLargeInput()
+        b = generateLargeInput()
+      }
+      guard a.isFinite, b.isFinite else {
+        continue
+      }
+
+      let (sum, error) = twoSum(a, b)
+      if sum.isFinite {
+        let (hi, lo) = unpack(mf64_float64_two_sum(pack(a), pack(b)))
+        let (fastHi, fastLo) = unpack(abs(a) >= abs(b)
+          ? mf64_float64_fast_two_sum(pack(a), pack(b))
+          : mf64_float64_fast_two_sum(pack(b), pack(a)))
+        guard hi == sum, lo == error, fastHi == sum, fastLo == error else {
+          XCTFail("two_sum(\(a), \(b)): (\(sum), \(error)) != (\(hi), \(lo))")
+          return
+        }
+      }
+
+      let product = a * b
+      if product.isFinite {
+        let error = (-product).addingProduct(a, b)
+        let (hi, lo) = unpack(mf64_float64_two_prod(pack(a), pack(b)))
+        guard hi == product, lo == error else {
+          XCTFail("two_prod(\(a), \(b)): (\(product), \(error)) != (\(hi), \(lo))")
+          return
+        }
+      }
+
+      let (hi, lo) = unpack(mf64_float64_split(pack(a)))
+      let truncated = abs(a) >= 0x1.ffffffcp1023
+      guard hi.isFinite, hi + lo == a,
+            hi.significandWidth <= 25,
+            lo.significandWidth <= (truncated ? 26 : 25) else {
+        XCTFail("split(\(a)): (\(hi), \(lo))")
+        return
+      }
+    }
+
+    for i in 0..<(1 << 20) {
+      var a = Float(Double.random(in: -1...1) * pow(2, .random(in: -30...30)))
+      var b = Float(Double.random(in: -1...1) * pow(2, .random(in: -30...30)))
+      if i % 4 == 0 {
+        // Within 2^14 ulps of the largest finite float
+        a = Float(bitPattern: 0x7F7F_FFFF - .random(in: 0..<(1 << 14)))
+        b = Float(bitPattern: 0x7F7F_FFFF - .random(in: 0..<(1 << 14)))
+        b = Bool.random() ? b : -b
+      } else if i % 4 == 1 {
+        a = Float(bitPattern: .random(in: 0...0x7F7F_FFFF))
+        b = -Float(bitPattern: .random(in: 0...0x7F7F_FFFF))
+      }
+      let sum = mf64_two_sum(a, b)
+      let product = mf64_two_prod(a, b)
+      let halves = mf64_split(a)
+
+      // The product is exact in `Double`, unless its error underflows.
+      let (expectedSum, expectedError) = twoSum(a, b)
+      let exactProduct = Double(a) * Double(b)
+      guard !expectedSum.isFinite ||
+              (sum.hi == expectedSum && sum.lo == expectedError),
+            !(a * b).isFinite || abs(exactProduct) < 0x1p-100 ||
+              Double(product.hi) + Double(product.lo) == exactProduct,
+            halves.hi.isFinite, halves.hi + halves.lo == a,
+            halves.hi.significandWidth <= 11,
+            halves.lo.significandWidth <= 11 else {
+        XCTFail("Error-free transformations of (\(a), \(b))")
+        return
+      }
+    }
+  }
+
+  // Reports how many error-free transformations the host performs per second.
+  func testErrorFreeThroughput() throws {
+    let iterations = 1 << 22
+    let inputs = (0..<1024).map { _ in Double.random(in: 1...2) }
+
+    func benchmark(_ name: String, _ body: (Int) -> UInt64) {
+      let start = Date()
+      var checksum: UInt64 = 0
+      for i in 0..<iterations {
+        checksum &+= body(i & 1023)
+      }
+      let seconds = Date().timeIntervalSince(start)
+      XCTAssertNotEqual(checksum, 1)
+      print("\(name): \(Double(iterations) / seconds / 1e6) M ops/s")
+    }
+
+    // Running twice prevents the first run from including warmup time.
+    for _ in 0..<2 {
+      benchmark("float two_sum") {
+        let x = mf64_two_sum(Float(inputs[$0]), Float(inputs[$0 ^ 1]))
+        return UInt64(x.lo.bitPattern)
+      }
+      benchmark("float fast_two_sum") {
+        let x = mf64_fast_two_sum(Float(inputs[$0]), Float(inputs[$0 ^ 1]))
+        return UInt64(x.lo.bitPattern)
+      }
+      benchmark("float two_prod") {
+        let x = mf64_two_prod(Float(inputs[$0]), Float(inputs[$0 ^ 1]))
+        return UInt64(x.lo.bitPattern)
+      }
+      benchmark("float split") {
+        UInt64(mf64_split(Float(inputs[$0])).lo.bitPattern)
+      }
+      benchmark("float64_t two_sum") {
+        let x = mf64_float64_two_sum(
+          mf64_float64_t(data: inputs[$0].bitPattern),
+          mf64_float64_t(data: inputs[$0 ^ 1].bitPattern))
+        return x.lo.data
+      }
+      benchmark("float64_t fast_two_sum") {
+        let x = mf64_float64_fast_two_sum(
+          mf64_float64_t(data: inputs[$0].bitPattern),
+          mf64_float64_t(data: inputs[$0 ^ 1].bitPattern))
+        return x.lo.data
+      }
+      benchmark("float64_t two_prod") {
+        let x = mf64_float64_two_prod(
+          mf64_float64_t(data: inputs[$0].bitPattern),
+          mf64_float64_t(data: inputs[$0 ^ 1].bitPattern))
+        return x.lo.data
+      }
+      benchmark("float64_t split") {
+        mf64_float64_split(mf64_float64_t(data: inputs[$0].bitPattern)).lo.data
+      }
+    }
+  }
+
+  // Reports how many emulated operations the host performs per second, next
+  // to native `Double`.
+  func testCoreThroughput() throws {
+    let iterations = 1 << 22
+
+    func benchmark(_ name: String, _ body: () -> UInt64) {
+      let start = Date()
+      let checksum = body()
+      let seconds = Date().timeIntervalSince(start)
+      XCTAssertNotEqual(checksum, 1)
+      print("\(name): \(Double(iterations) / seconds / 1e6) M ops/s")
+    }
+
+    // Running twice prevents the first run from including warmup time.
+    for _ in 0..<2 {
+      benchmark("Double add") {
+        var x = 0.0
+        for i in 0..<iterations {
+          x = x + Double(i & 7)
+        }
+        return x.bitPattern
+      }
+      benchmark("float64_t add") {
+        var x = mf64_float64_t(data: 0)
+        for i in 0..<iterations {
+          x = mf64_float64_add(x, mf64_float64_t(data: Double(i & 7).bitPattern))
+        }
+        return x.data
+      }
+      benchmark("float64_t multiply") {
+        var x = mf64_float64_t(data: Double(1).bitPattern)
+        let factor = mf64_float64_t(data: Double(1.0000001).bitPattern)
+        for _ in 0..<iterations {
+          x = mf64_float64_multiply(x, factor)
+        }
+        return x.data
+      }
+      benchmark("float32x2_t fma") {
+        var x = mf64_float32x2_t(hi: 0, lo: 0)
+        let factor = mf64_float32x2_t(hi: 0.5, lo: 0)
+        let addend = mf64_float32x2_t(hi: 1, lo: 0x1p-30)
+        for _ in 0..<iterations {
+          x = mf64_float32x2_fma(x, factor, addend)
+        }
+        return UInt64(x.hi.bitPattern)
+      }
+    }
+  }
+
+  // Reports how many degree-13 polynomials the host evaluates per second with
+  // Horner's scheme, matching "testPolynomialThroughput" on the GPU.
+  func testPolynomialThroughput() throws {
+    let iterations = 1 << 18
+    let inputs = (0..<1024).map { _ in Double.random(in: -0.25...0.25) }
+
+    // Taylor series of exp(-x), stored in each coefficient format.
+    let coefficients: [Double] = (0..<14).map { k in
+      let factorial = (1...max(k, 1)).reduce(1.0) { $0 * Double($1) }
+      return (k % 2 == 0 ? 1 : -1) / factorial
+    }
+    let coefficients32 = coefficients.map { Float($0) }
+    let coefficients64 = coefficients.map {
+      mf64_accum_from_float64(mf64_float64_t(data: $0.bitPattern))
+    }
+    let coefficients32x2 = coefficients.map { c -> mf64_float32x2_t in
+      let hi = Float(c)
+      return mf64_float32x2_t(hi: hi, lo: Float(c - Double(hi)))
+    }
+
+    func benchmark(_ name: String, _ body: (Double) -> UInt64) {
+      let start = Date()
+      var checksum: UInt64 = 0
+      for i in 0..<iterations {
+        checksum &+= body(inputs[i & 1023])
+      }
+      let seconds = Date().timeIntervalSince(start)
+      XCTAssertNotEqual(checksum, 1)
+      print("\(name): \(Double(iterations) / seconds / 1e6) M polynomials/s")
+    }
+
+    // Running twice prevents the first run from including warmup time.
+    for _ in 0..<2 {
+      benchmark("Double Horner") { x in
+        var y = coefficients[13]
+        for k in (0..<13).reversed() {
+          y = y * x + coefficients[k]
+        }
+        return y.bitPattern
+      }
+      benchmark("float64_t Horner") { x in
+        let x = mf64_accum_from_float64(mf64_float64_t(data: x.bitPattern))
+        var y = coefficients64[13]
+        for k in (0..<13).reversed() {
+          y = mf64_accum_add(mf64_accum_multiply(y, x), coefficients64[k])
+        }
+        return mf64_accum_to_float64(y).data
+      }
+      benchmark("float64_t Horner (float coefficients)") { x in
+        let x = mf64_accum_from_float64(mf64_float64_t(data: x.bitPattern))
+        var y = mf64_accum_from_float(coefficients32[13])
+        for k in (0..<13).reversed() {
+          y = mf64_accum_add(
+            mf64_accum_multiply(y, x), mf64_accum_from_float(coefficients32[k]))
+        }
+        return mf64_accum_to_float64(y).data
+      }
+      benchmark("float32x2_t Horner") { x in
+        let hi = Float(x)
+        let x = mf64_float32x2_t(hi: hi, lo: Float(x - Double(hi)))
+        var y = coefficients32x2[13]
+        for k in (0..<13).reversed() {
+          y = mf64_float32x2_fma(y, x, coefficients32x2[k])
+        }
+        return UInt64(y.hi.bitPattern)
+      }
+      benchmark("float32x2_t Horner (float coefficients)") { x in
+        let hi = Float(x)
+        let x = mf64_float32x2_t(hi: hi, lo: Float(x - Double(hi)))
+        var y = mf64_float32x2_t(hi: coefficients32[13], lo: 0)
+        for k in (0..<13).reversed() {
+          y = mf64_float32x2_fma_float(y, x, coefficients32[k])
+        }
+        return UInt64(y.hi.bitPattern)
+      }
+    }
+  }
+}
+
+// Mixes random bit patterns (including INF, NAN, and denormals) with values
+// that round or cancel in interesting ways.
+private func generateCoreInput() -> Double {
+  let specials: [Double] = [
+    0, -0.0, .infinity, -.infinity, .nan, 1, -1, .leastNonzeroMagnitude,
+    .leastNormalMagnitude, .greatestFiniteMagnitude
+  ]
+  switch Int.random(in: 0..<4) {
+  case 0:
+    return Double(bitPattern: UInt64.random(in: 0...UInt64.max))
+  case 1:
+    return specials.randomElement()!
+  case 2:
+    return Double.random(in: -1...1) * 0x1p-1030
+  default:
+    return Double.random(in: -1...1) * pow(2, Double(Int.random(in: -40...40)))
+  }
+}
+
+// Finite values within 2^28 ulps of the largest finite number, with either
+// sign.
+private func generateLargeInput() -> Double {
+  let magnitude = Double(
+    bitPattern: 0x7FEF_FFFF_FFFF_FFFF - .random(in: 0..<(1 << 28)))
+  return Bool.random() ? magnitude : -magnitude
+}
+
+// Corrects a native cast, which rounds to nearest, into rounding toward zero.
+// That also turns overflow into the largest finite number.
+private func roundTowardZero<T: BinaryFloatingPoint>(
+  _ x: Double, _ rounded: T
+) -> T {
+  guard x.isFinite, abs(Double(rounded)) > abs(x) else {
+    return rounded
+  }
+  return (rounded.sign == .minus) ? rounded.nextUp : rounded.nextDown
+}
+
+// Rounds to an integer, then saturates. NAN becomes 0.
+private func saturatingInteger<T: FixedWidthInteger>(
+  _ x: Double, nearest: Bool, as type: T.Type
+) -> T {
+  let rounded = x.rounded(nearest ? .toNearestOrEven : .towardZero)
+  if rounded.isNaN {
+    return 0
+  }
+  if rounded >= -Double(T.min) {
+    return T.max
+  }
+  if rounded < Double(T.min) {
+    return T.min
+  }
+  return T(rounded)
+}
+
+// Rounds to a `double` with only `bits` explicit mantissa bits, the same as
+// `float59_t` (47) and `float43_t` (31). Scaling by the quantum is exact.
+private func roundFraction(
+  _ x: Double, bits: Int, truncating: Bool
+) -> Double {
+  guard x.isFinite, x != 0 else {
+    return x
+  }
+  let exponent = max(Int(x.exponent), -1022) - bits
+  let quantum = Double(sign: .plus, exponent: exponent, significand: 1)
+  let rule: FloatingPointRoundingRule =
+    truncating ? .towardZero : .toNearestOrEven
+  return (x / quantum).rounded(rule) * quantum
+}
+
+private func same<T: BinaryFloatingPoint>(_ lhs: T, _ rhs: T) -> Bool {
+  (lhs.isNaN && rhs.isNaN) || (lhs == rhs && lhs.sign == rhs.sign)
+}
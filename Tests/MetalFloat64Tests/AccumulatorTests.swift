@@ -0,0 +1,124 @@
+import XCTest
+
+final class AccumulatorTests: XCTestCase {
+  // Addition, subtraction, and multiplication must be correctly rounded.
+  func testFloat64Arithmetic() throws {
+    let count = 1 << 16
+    let lhs = generateRandomDoubles(count: count)
+    let rhs = generateRandomDoubles(count: count)
+    let device = Context.global.device
+    let lhsBuffer = device.makeBuffer(bytes: lhs, length: count * 8)!
+    let rhsBuffer = device.makeBuffer(bytes: rhs, length: count * 8)!
+    let outBuffer = device.makeBuffer(length: 3 * count * 8)!
+    
+    Context.global.withComputeEncoder { encoder in
+      let pipeline = Context.global.pipelines["testFloat64Arithmetic"]!
+      encoder.setComputePipelineState(pipeline)
+      encoder.setBuffer(lhsBuffer, offset: 0, index: 0)
+      encoder.setBuffer(rhsBuffer, offset: 0, index: 1)
+      encoder.setBuffer(outBuffer, offset: 0, index: 2)
+      encoder.dispatchThreads(
+        MTLSizeMake(count, 1, 1), threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+    }
+    
+    let output = outBuffer.contents().assumingMemoryBound(to: Double.self)
+    for i in 0..<count {
+      let a = lhs[i]
+      let b = rhs[i]
+      let expected = [a + b, a - b, a * b]
+      for j in 0..<3 {
+        let actual = output[3 * i + j]
+        if expected[j].isNaN && actual.isNaN {
+          continue
+        }
+        guard expected[j].bitPattern == actual.bitPattern else {
+          XCTFail("Operation \(j) on \(a) and \(b): \(expected[j]) != \(actual)")
+          return
+        }
+      }
+    }
+  }
+  
+  // Each of the 127 operations adds at most 2^-60 error relative to the partial
+  // sums, which are bounded by the sum of the products' magnitudes. The terms
+  // often cancel, so this can be much larger than 1 ulp of the result. Both
+  // sides round once more at the end.
+  func testAccumulatorDotProduct() throws {
+    let itemsPerThread = 64
+    let numThreads = 4096
+    let count = itemsPerThread * numThreads
+    let lhs = (0..<count).map { _ in Double.random(in: -1000...1000) }
+    let rhs = (0..<count).map { _ in Double.random(in: 0...1) }
+    let device = Context.global.device
+    let lhsBuffer = device.makeBuffer(bytes: lhs, length: count * 8)!
+    let rhsBuffer = device.makeBuffer(bytes: rhs, length: count * 8)!
+    let outBuffer = device.makeBuffer(length: numThreads * 8)!
+    
+    Context.global.withComputeEncoder { encoder in
+      let pipeline = Context.global.pipelines["testAccumulatorDotProduct"]!
+      encoder.setComputePipelineState(pipeline)
+      var _itemsPerThread = UInt32(itemsPerThread)
+      encoder.setBytes(&_itemsPerThread, length: 4, index: 0)
+      encoder.setBuffer(lhsBuffer, offset: 0, index: 1)
+      encoder.setBuffer(rhsBuffer, offset: 0, index: 2)
+      encoder.setBuffer(outBuffer, offset: 0, index: 3)
+      encoder.dispatchThreads(
+        MTLSizeMake(numThreads, 1, 1),
+        threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+    }
+    
+    let output = outBuffer.contents().assumingMemoryBound(to: Double.self)
+    for i in 0..<numThreads {
+      let range = i * itemsPerThread..<(i + 1) * itemsPerThread
+      let expected = compensatedDotProduct(lhs[range], rhs[range])
+      let magnitude = zip(lhs[range], rhs[range]).reduce(0) { $0 + abs($1.0 * $1.1) }
+      let tolerance = Double(itemsPerThread) * 0x1p-60 * magnitude + expected.ulp
+      let actual = output[i]
+      guard abs(actual - expected) <= tolerance else {
+        XCTFail("Thread \(i): \(expected) != \(actual)")
+        return
+      }
+    }
+  }
+}
+
+// Mixes random bit patterns (including INF, NAN, and denormals) with values
+// that stress rounding and cancellation.
+private func generateRandomDoubles(count: Int) -> [Double] {
+  let specials: [Double] = [
+    0, -0, .infinity, -.infinity, .nan, 1, -1, .leastNonzeroMagnitude,
+    .leastNormalMagnitude, .greatestFiniteMagnitude
+  ]
+  return (0..<count).map { i in
+    switch i % 4 {
+    case 0:
+      return Double(bitPattern: UInt64.random(in: 0...UInt64.max))
+    case 1:
+      return specials.randomElement()!
+    case 2:
+      return Double(Int.random(in: -1000...1000)) * 0x1p-20
+    default:
+      return Double.random(in: -1...1) * 0x1p-1020
+    }
+  }
+}
+
+// Reference dot product with twice the working precision (Ogita, Rump, and
+// Oishi, "Accurate Sum and Dot Product").
+private func compensatedDotProduct(
+  _ lhs: ArraySlice<Double>,
+  _ rhs: ArraySlice<Double>
+) -> Double {
+  var sum: Double = 0
+  var error: Double = 0
+  for (a, b) in zip(lhs, rhs) {
+    let product = a * b
+    let productError = (-product).addingProduct(a, b)
+    let newSum = sum + product
+    let virtualProduct = newSum - sum
+    let sumError = (sum - (newSum - virtualProduct)) + (product - virtualProduct)
+    sum = newSum
+    error += productError + sumError
+  }
+  return sum + error
+}
@@ -1,4 +1,5 @@
 import XCTest
+import MetalAtomic64
 
 // This test suite is sourced from:
 // https://github.com/philipturner/ue5-nanite-macos/tree/main/AtomicsWorkaround
@@ -102,6 +103,92 @@ final class AtomicTests: XCTestCase {
       $0 + $1
     }
   }
+  
+  // The host model of `get_lock` must never index past the lock table.
+  func testLockIndexBounds() throws {
+    let configurations = [
+      MetalAtomic64LockConfiguration(),
+      MetalAtomic64LockConfiguration(locksPerShard: 1 << 8),
+      MetalAtomic64LockConfiguration(
+        locksPerShard: 1 << 24, shardCount: 4, hash: .multiplicative),
+      MetalAtomic64LockConfiguration(
+        locksPerShard: 1 << 10, shardCount: 256, shardSize: 8),
+      MetalAtomic64LockConfiguration(
+        locksPerShard: 1 << 12, shardCount: 16, shardSize: 1 << 62,
+        hash: .multiplicative),
+    ]
+    for configuration in configurations {
+      for i in 0..<(1 << 16) {
+        var address = UInt64.random(in: 0 ... .max) & ~7
+        if i < 2 {
+          address = (i == 0) ? 0 : ~7
+        }
+        let index = configuration.lockIndex(address: address)
+        guard index >= 0 && index < configuration.lockCount else {
+          XCTFail("\(configuration) mapped \(address) to lock \(index).")
+          return
+        }
+      }
+    }
+    
+    // The default configuration matches the hash that shipped before locks
+    // were configurable.
+    let configuration = MetalAtomic64LockConfiguration()
+    for _ in 0..<(1 << 16) {
+      let address = UInt64.random(in: 0 ... .max) & ~7
+      let lowerBits = UInt32(truncatingIfNeeded: address)
+      let legacyOffset = ((lowerBits >> 1) & 0x3FFFF) ^ (0x5A39 << 2)
+      XCTAssertEqual(
+        configuration.lockIndex(address: address), Int(legacyOffset >> 2))
+    }
+  }
+  
+  func testLockSharding() throws {
+    let configuration = MetalAtomic64LockConfiguration(
+      locksPerShard: 1 << 10, shardCount: 4, shardSize: 1 << 20)
+    let shardRange = 0..<configuration.locksPerShard
+    for shard in 0..<configuration.shardCount {
+      for _ in 0..<1024 {
+        let offset = UInt64.random(in: 0..<(1 << 20)) & ~7
+        let address = UInt64(shard + 4 * .random(in: 0..<1024)) << 20 + offset
+        let index = configuration.lockIndex(address: address)
+        XCTAssert(shardRange.contains(index - shard * shardRange.count))
+      }
+    }
+  }
+  
+  // Compares the fraction of objects that share a lock against the birthday
+  // problem: with N objects and L locks, 1 - (1 - 1/L)^(N - 1).
+  func testLockCollisionRate() throws {
+    let objectCount = Configuration.outBufferSize
+    let scattered = (0..<objectCount).map { _ in
+      UInt64.random(in: 0..<(1 << 40)) & ~7
+    }
+    let strided = (0..<objectCount).map { UInt64($0) << 19 }
+    
+    for hash in [MetalAtomic64LockHash.xorMask, .multiplicative] {
+      for locksLog2 in [12, 16, 20, 24] {
+        let configuration = MetalAtomic64LockConfiguration(
+          locksPerShard: 1 << locksLog2, hash: hash)
+        let lockCount = Double(configuration.lockCount)
+        let expected = 1 - pow(1 - 1 / lockCount, Double(objectCount - 1))
+        let scatteredRate = configuration.collisionRate(addresses: scattered)
+        let stridedRate = configuration.collisionRate(addresses: strided)
+        let message = "\(hash), 2^\(locksLog2) locks"
+        XCTAssertEqual(
+          scatteredRate, expected, accuracy: 0.05, "\(message), scattered")
+        
+        // A stride of 2^16 words defeats the XOR hash, but not Fibonacci
+        // hashing.
+        if hash == .multiplicative {
+          XCTAssertLessThanOrEqual(
+            stridedRate, expected + 0.05, "\(message), strided")
+        } else if locksLog2 <= 16 {
+          XCTAssertEqual(stridedRate, 1, "\(message), strided")
+        }
+      }
+    }
+  }
 }
 
 private struct RandomData {
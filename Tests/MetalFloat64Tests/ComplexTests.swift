@@ -0,0 +1,356 @@
+import XCTest
+import MetalFloat64Core
+
+final class ComplexTests: XCTestCase {
+  // Matches `fftSize` in "ComplexTests.metal".
+  static let fftSize = 16
+
+  // Products are rounded once, so the error is bounded by the magnitude of the
+  // terms rather than the result.
+  func testComplexArithmetic() throws {
+    let count = 1 << 14
+    for (name, tolerance) in [("Float64", 0x1p-51), ("Float32x2", 0x1p-43)] {
+      let isFloat64 = name == "Float64"
+      let input = (0..<3 * count).map { _ in
+        let x = Complex(.random(in: -1...1), .random(in: -1...1))
+        return isFloat64 ? x : roundToFloat32x2(x)
+      }
+      let output = runComplexKernel(
+        "testComplexArithmetic" + name, input: input, isFloat64: isFloat64)
+
+      for i in 0..<count {
+        let a = input[3 * i + 0]
+        let b = input[3 * i + 1]
+        let c = input[3 * i + 2]
+
+        func l1(_ x: Complex) -> Double { abs(x.real) + abs(x.imag) }
+        let magnitude = max(l1(a) * l1(b) + l1(c), l1(a) * l1(a))
+        let product = a * b
+        let fused = product + c
+        let expected = [
+          product.real, product.imag, fused.real, fused.imag,
+          a.real * a.real + a.imag * a.imag
+        ]
+        let actual = [
+          output[3 * i].real, output[3 * i].imag, output[3 * i + 1].real,
+          output[3 * i + 1].imag, output[3 * i + 2].real
+        ]
+        for j in 0..<5 {
+          guard abs(actual[j] - expected[j]) <= tolerance * magnitude else {
+            XCTFail("\(name) output \(j) at \(i): \(expected[j]) != \(actual[j])")
+            return
+          }
+        }
+      }
+    }
+  }
+
+  // Compares the emulated FFTs against the same algorithm in native `Double`.
+  func testFFT() throws {
+    let count = 1 << 12
+    let input = (0..<count * Self.fftSize).map { _ in
+      Complex(.random(in: -1...1), .random(in: -1...1))
+    }
+    var expected = input
+    for i in 0..<count {
+      let range = (i * Self.fftSize)..<((i + 1) * Self.fftSize)
+      expected.replaceSubrange(range, with: hostFFT(Array(input[range])))
+    }
+
+    // On the host, the emulated `float64_t` rounds after every operation, just
+    // like `Double`, so the two match bit for bit.
+    for i in 0..<64 {
+      let range = (i * Self.fftSize)..<((i + 1) * Self.fftSize)
+      let emulated = hostFFT(input[range].map(HostComplex<EmulatedFloat64>.init))
+      for (actual, expected) in zip(emulated, expected[range]) {
+        guard actual.real.value.data == expected.real.bitPattern,
+              actual.imag.value.data == expected.imag.bitPattern else {
+          XCTFail("Host float64_t FFT at \(i)")
+          return
+        }
+      }
+    }
+
+    for (name, tolerance) in [("Float64", 4e-15), ("Float32x2", 1e-13)] {
+      for radix in [2, 4] {
+        let output = runFFT(
+          "testFFTRadix\(radix)\(name)", input: input,
+          isFloat64: name == "Float64")
+        var maxError: Double = 0
+        for i in 0..<input.count {
+          let error = output[i] - expected[i]
+          maxError = max(maxError, max(abs(error.real), abs(error.imag)))
+        }
+        // Every output's magnitude is at most 2 * fftSize.
+        let relativeError = maxError / Double(2 * Self.fftSize)
+        XCTAssertLessThanOrEqual(
+          relativeError, tolerance, "Radix-\(radix) \(name) FFT error")
+      }
+    }
+  }
+
+  // Reports how many 16-point FFTs each configuration performs per second,
+  // next to the same algorithm on the CPU, in native `Double` and in the
+  // emulated `float64_t` from "MetalFloat64Core".
+  func testFFTThroughput() throws {
+    let numThreads = 1 << 14
+    let iterations = 64
+    let twiddles = makeTwiddles()
+
+    func benchmark(_ name: String, isFloat64: Bool) {
+      let data = [Complex](
+        repeating: Complex(0.5, 0), count: numThreads * Self.fftSize)
+      let twiddleBuffer = makeBuffer(twiddles, isFloat64: isFloat64)
+      let dataBuffer = makeBuffer(data, isFloat64: isFloat64)
+      let pipeline = Context.global.pipelines["benchmarkFFT" + name]!
+
+      let commandBuffer = Context.global.withCommandBuffer { commandBuffer in
+        let encoder = commandBuffer.makeComputeCommandEncoder()!
+        encoder.setComputePipelineState(pipeline)
+        var _iterations = UInt32(iterations)
+        encoder.setBytes(&_iterations, length: 4, index: 0)
+        encoder.setBuffer(twiddleBuffer, offset: 0, index: 1)
+        encoder.setBuffer(dataBuffer, offset: 0, index: 2)
+        encoder.dispatchThreads(
+          MTLSizeMake(numThreads, 1, 1),
+          threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+        encoder.endEncoding()
+        return commandBuffer
+      }
+
+      let seconds = commandBuffer.gpuEndTime - commandBuffer.gpuStartTime
+      let transforms = Double(numThreads * iterations)
+      print("\(name): \(transforms / seconds / 1e6) M FFTs/s")
+    }
+
+    func benchmarkHost<Scalar: HostScalar>(_ name: String, _: Scalar.Type) {
+      let scale = Scalar(1 / Double(Self.fftSize))
+      var data = [HostComplex<Scalar>](
+        repeating: HostComplex(Complex(0.5, 0)), count: Self.fftSize)
+      let start = Date()
+      for _ in 0..<numThreads {
+        data = hostFFT(data).map { $0 * scale }
+      }
+      let seconds = Date().timeIntervalSince(start)
+      XCTAssertFalse(data[0].real.doubleValue.isNaN)
+      print("Host \(name): \(Double(numThreads) / seconds / 1e6) M FFTs/s")
+    }
+
+    // Running twice prevents the first run from including warmup time.
+    for _ in 0..<2 {
+      benchmark("Radix2Float64", isFloat64: true)
+      benchmark("Radix4Float64", isFloat64: true)
+      benchmark("Radix2Float32x2", isFloat64: false)
+      benchmark("Radix4Float32x2", isFloat64: false)
+      benchmarkHost("Double", Double.self)
+      benchmarkHost("float64_t", EmulatedFloat64.self)
+    }
+  }
+}
+
+// MARK: - Host Reference
+
+// The arithmetic that the host FFT needs, so it can run on native `Double` or
+// on the emulated `float64_t` from "MetalFloat64Core".
+private protocol HostScalar {
+  init(_ x: Double)
+  var doubleValue: Double { get }
+  static func + (lhs: Self, rhs: Self) -> Self
+  static func - (lhs: Self, rhs: Self) -> Self
+  static func * (lhs: Self, rhs: Self) -> Self
+}
+
+extension Double: HostScalar {
+  var doubleValue: Double { self }
+}
+
+private struct EmulatedFloat64: HostScalar {
+  var value: mf64_float64_t
+
+  init(_ value: mf64_float64_t) {
+    self.value = value
+  }
+
+  init(_ x: Double) {
+    value = mf64_float64_t(data: x.bitPattern)
+  }
+
+  var doubleValue: Double { Double(bitPattern: value.data) }
+
+  static func + (lhs: Self, rhs: Self) -> Self {
+    Self(mf64_float64_add(lhs.value, rhs.value))
+  }
+
+  static func - (lhs: Self, rhs: Self) -> Self {
+    Self(mf64_float64_subtract(lhs.value, rhs.value))
+  }
+
+  static func * (lhs: Self, rhs: Self) -> Self {
+    Self(mf64_float64_multiply(lhs.value, rhs.value))
+  }
+}
+
+private struct HostComplex<Scalar: HostScalar> {
+  var real: Scalar
+  var imag: Scalar
+
+  init(_ real: Scalar, _ imag: Scalar) {
+    self.real = real
+    self.imag = imag
+  }
+
+  init(_ x: Complex) {
+    self.init(Scalar(x.real), Scalar(x.imag))
+  }
+
+  static func + (lhs: Self, rhs: Self) -> Self {
+    Self(lhs.real + rhs.real, lhs.imag + rhs.imag)
+  }
+
+  static func - (lhs: Self, rhs: Self) -> Self {
+    Self(lhs.real - rhs.real, lhs.imag - rhs.imag)
+  }
+
+  static func * (lhs: Self, rhs: Self) -> Self {
+    Self(
+      lhs.real * rhs.real - lhs.imag * rhs.imag,
+      lhs.real * rhs.imag + lhs.imag * rhs.real)
+  }
+
+  static func * (lhs: Self, rhs: Scalar) -> Self {
+    Self(lhs.real * rhs, lhs.imag * rhs)
+  }
+}
+
+private typealias Complex = HostComplex<Double>
+
+// exp(-2 pi i k / N), for every k < N.
+private func makeTwiddles() -> [Complex] {
+  let size = ComplexTests.fftSize
+  return (0..<size).map { k in
+    let angle = -2 * Double.pi * Double(k) / Double(size)
+    return Complex(cos(angle), sin(angle))
+  }
+}
+
+// Radix-2 decimation in time, using the same butterflies as the GPU.
+private func hostFFT<Scalar>(
+  _ input: [HostComplex<Scalar>]
+) -> [HostComplex<Scalar>] {
+  let size = input.count
+  let bits = size.trailingZeroBitCount
+  let twiddles = makeTwiddles().map(HostComplex<Scalar>.init)
+  var x = input
+  for i in 0..<size {
+    let reversed = Int(UInt(i).bitReversed(bits: bits))
+    x[reversed] = input[i]
+  }
+
+  var m = 2
+  while m <= size {
+    for k in stride(from: 0, to: size, by: m) {
+      for j in 0..<m / 2 {
+        let t = twiddles[j * (size / m)] * x[k + j + m / 2]
+        x[k + j + m / 2] = x[k + j] - t
+        x[k + j] = x[k + j] + t
+      }
+    }
+    m *= 2
+  }
+  return x
+}
+
+private extension UInt {
+  func bitReversed(bits: Int) -> UInt {
+    var output: UInt = 0
+    for i in 0..<bits where self & (1 << i) != 0 {
+      output |= 1 << (bits - 1 - i)
+    }
+    return output
+  }
+}
+
+// MARK: - GPU Dispatch
+
+// `float32x2_t` stores each component as a pair of floats.
+private func makeBuffer(_ data: [Complex], isFloat64: Bool) -> MTLBuffer {
+  let device = Context.global.device
+  let components = data.flatMap { [$0.real, $0.imag] }
+  if isFloat64 {
+    return device.makeBuffer(bytes: components, length: components.count * 8)!
+  } else {
+    let pairs = components.map { x -> SIMD2<Float> in
+      let hi = Float(x)
+      return SIMD2(hi, Float(x - Double(hi)))
+    }
+    return device.makeBuffer(bytes: pairs, length: pairs.count * 8)!
+  }
+}
+
+private func readBuffer(_ buffer: MTLBuffer, isFloat64: Bool) -> [Complex] {
+  let count = buffer.length / 16
+  var output: [Complex] = []
+  if isFloat64 {
+    let pointer = buffer.contents().assumingMemoryBound(to: Double.self)
+    for i in 0..<count {
+      output.append(Complex(pointer[2 * i], pointer[2 * i + 1]))
+    }
+  } else {
+    let pointer = buffer.contents().assumingMemoryBound(to: SIMD2<Float>.self)
+    func widen(_ x: SIMD2<Float>) -> Double { Double(x[0]) + Double(x[1]) }
+    for i in 0..<count {
+      output.append(Complex(widen(pointer[2 * i]), widen(pointer[2 * i + 1])))
+    }
+  }
+  return output
+}
+
+private func runFFT(
+  _ name: String, input: [Complex], isFloat64: Bool
+) -> [Complex] {
+  let count = input.count / ComplexTests.fftSize
+  let twiddleBuffer = makeBuffer(makeTwiddles(), isFloat64: isFloat64)
+  let inputBuffer = makeBuffer(input, isFloat64: isFloat64)
+  let outputBuffer = Context.global.device.makeBuffer(
+    length: inputBuffer.length)!
+
+  Context.global.withComputeEncoder { encoder in
+    let pipeline = Context.global.pipelines[name]!
+    encoder.setComputePipelineState(pipeline)
+    encoder.setBuffer(twiddleBuffer, offset: 0, index: 0)
+    encoder.setBuffer(inputBuffer, offset: 0, index: 1)
+    encoder.setBuffer(outputBuffer, offset: 0, index: 2)
+    encoder.dispatchThreads(
+      MTLSizeMake(count, 1, 1), threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+  }
+  return readBuffer(outputBuffer, isFloat64: isFloat64)
+}
+
+// Rounds each component the same way as `makeBuffer`, so the host sees the
+// same inputs as the GPU.
+private func roundToFloat32x2(_ x: Complex) -> Complex {
+  func round(_ x: Double) -> Double {
+    let hi = Float(x)
+    return Double(hi) + Double(Float(x - Double(hi)))
+  }
+  return Complex(round(x.real), round(x.imag))
+}
+
+private func runComplexKernel(
+  _ name: String, input: [Complex], isFloat64: Bool
+) -> [Complex] {
+  let inputBuffer = makeBuffer(input, isFloat64: isFloat64)
+  let outputBuffer = Context.global.device.makeBuffer(
+    length: inputBuffer.length)!
+
+  Context.global.withComputeEncoder { encoder in
+    let pipeline = Context.global.pipelines[name]!
+    encoder.setComputePipelineState(pipeline)
+    encoder.setBuffer(inputBuffer, offset: 0, index: 0)
+    encoder.setBuffer(outputBuffer, offset: 0, index: 1)
+    encoder.dispatchThreads(
+      MTLSizeMake(input.count / 3, 1, 1),
+      threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+  }
+  return readBuffer(outputBuffer, isFloat64: isFloat64)
+}
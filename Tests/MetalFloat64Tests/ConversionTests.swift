@@ -0,0 +1,312 @@
+import XCTest
+
+final class ConversionTests: XCTestCase {
+  func testConversionsFromDouble() throws {
+    let count = 1 << 16
+    let input = generateConversionInputs(count: count)
+    let device = Context.global.device
+    let inputBuffer = device.makeBuffer(bytes: input, length: count * 8)!
+    let floatBuffer = device.makeBuffer(length: 2 * count * 4)!
+    let halfBuffer = device.makeBuffer(length: 2 * count * 2)!
+    let intBuffer = device.makeBuffer(length: 2 * count * 4)!
+    let longBuffer = device.makeBuffer(length: 2 * count * 8)!
+    let float32x2Buffer = device.makeBuffer(length: 2 * count * 8)!
+    let reducedBuffer = device.makeBuffer(length: 4 * count * 8)!
+
+    Context.global.withComputeEncoder { encoder in
+      let pipeline = Context.global.pipelines["testConversionsFromDouble"]!
+      encoder.setComputePipelineState(pipeline)
+      encoder.setBuffer(inputBuffer, offset: 0, index: 0)
+      encoder.setBuffer(floatBuffer, offset: 0, index: 1)
+      encoder.setBuffer(halfBuffer, offset: 0, index: 2)
+      encoder.setBuffer(intBuffer, offset: 0, index: 3)
+      encoder.setBuffer(longBuffer, offset: 0, index: 4)
+      encoder.setBuffer(float32x2Buffer, offset: 0, index: 5)
+      encoder.setBuffer(reducedBuffer, offset: 0, index: 6)
+      encoder.dispatchThreads(
+        MTLSizeMake(count, 1, 1), threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+    }
+
+    let floats = floatBuffer.contents().assumingMemoryBound(to: Float.self)
+    let halfs = halfBuffer.contents().assumingMemoryBound(to: UInt16.self)
+    let ints = intBuffer.contents().assumingMemoryBound(to: Int32.self)
+    let longs = longBuffer.contents().assumingMemoryBound(to: Int64.self)
+    let float32x2s = float32x2Buffer.contents()
+      .assumingMemoryBound(to: SIMD2<Float>.self)
+    let reduced = reducedBuffer.contents().assumingMemoryBound(to: UInt64.self)
+
+    for i in 0..<count {
+      let x = input[i]
+      let nearest = x.rounded(.toNearestOrEven)
+      func check(_ condition: Bool, _ name: String) -> Bool {
+        if !condition {
+          XCTFail("Converting \(x) to \(name)")
+        }
+        return condition
+      }
+
+      guard check(same(floats[2 * i], Float(x)), "float"),
+            check(same(floats[2 * i + 1], truncateToFloat(x)), "float (RTZ)"),
+            check(sameHalf(halfs[2 * i], roundToHalf(x, .toNearestOrEven)), "half"),
+            check(sameHalf(halfs[2 * i + 1], roundToHalf(x, .towardZero)), "half (RTZ)"),
+            check(ints[2 * i] == saturatingCast(nearest), "int"),
+            check(ints[2 * i + 1] == saturatingCast(x), "int (RTZ)"),
+            check(longs[2 * i] == saturatingCast(nearest), "long"),
+            check(longs[2 * i + 1] == saturatingCast(x), "long (RTZ)"),
+            check(reduced[4 * i] == reduce(x, 47, .toNearestOrEven), "float59_t"),
+            check(reduced[4 * i + 1] == reduce(x, 47, .towardZero), "float59_t (RTZ)"),
+            check(reduced[4 * i + 2] == reduce(x, 31, .toNearestOrEven), "float43_t"),
+            check(reduced[4 * i + 3] == reduce(x, 31, .towardZero), "float43_t (RTZ)")
+      else {
+        return
+      }
+
+      // The double-single format only covers the range of normal floats.
+      if abs(x) > 0x1p-100 && abs(x) < 0x1p100 {
+        // The subtractions are exact.
+        let hi = Float(x)
+        let lo = Float(x - Double(hi))
+        let hiRTZ = truncateToFloat(x)
+        let loRTZ = truncateToFloat(x - Double(hiRTZ))
+        guard check(float32x2s[2 * i] == SIMD2(hi, lo), "float32x2_t"),
+              check(float32x2s[2 * i + 1] == SIMD2(hiRTZ, loRTZ), "float32x2_t (RTZ)")
+        else {
+          return
+        }
+      }
+    }
+  }
+
+  func testConversionsToDouble() throws {
+    let count = 1 << 16
+    let floats = generateConversionInputs(count: count).map { Float($0) }
+    let halfs = generateConversionInputs(count: count).map {
+      roundToHalf($0, .toNearestOrEven)
+    }
+    let ints = (0..<count).map { _ in Int32.random(in: .min ... .max) }
+    let longs = (0..<count).map { i in
+      Int64.random(in: .min ... .max) >> (i % 64)
+    }
+    let device = Context.global.device
+    let floatBuffer = device.makeBuffer(bytes: floats, length: count * 4)!
+    let halfBuffer = device.makeBuffer(bytes: halfs, length: count * 2)!
+    let intBuffer = device.makeBuffer(bytes: ints, length: count * 4)!
+    let longBuffer = device.makeBuffer(bytes: longs, length: count * 8)!
+    let outputBuffer = device.makeBuffer(length: 4 * count * 8)!
+
+    Context.global.withComputeEncoder { encoder in
+      let pipeline = Context.global.pipelines["testConversionsToDouble"]!
+      encoder.setComputePipelineState(pipeline)
+      encoder.setBuffer(floatBuffer, offset: 0, index: 0)
+      encoder.setBuffer(halfBuffer, offset: 0, index: 1)
+      encoder.setBuffer(intBuffer, offset: 0, index: 2)
+      encoder.setBuffer(longBuffer, offset: 0, index: 3)
+      encoder.setBuffer(outputBuffer, offset: 0, index: 4)
+      encoder.dispatchThreads(
+        MTLSizeMake(count, 1, 1), threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+    }
+
+    let output = outputBuffer.contents().assumingMemoryBound(to: Double.self)
+    for i in 0..<count {
+      let expected = [
+        Double(floats[i]), widenHalf(halfs[i]), Double(ints[i]), Double(longs[i])
+      ]
+      for j in 0..<4 {
+        guard same(output[4 * i + j], expected[j]) else {
+          XCTFail("Conversion \(j) at \(i): \(expected[j]) != \(output[4 * i + j])")
+          return
+        }
+      }
+    }
+  }
+
+  func testConversionVectors() throws {
+    let count = 1 << 12
+    let input = generateConversionInputs(count: 4 * count)
+    let device = Context.global.device
+    let inputBuffer = device.makeBuffer(bytes: input, length: 4 * count * 8)!
+    let outputBuffer = device.makeBuffer(length: 8 * count * 4)!
+
+    Context.global.withComputeEncoder { encoder in
+      let pipeline = Context.global.pipelines["testConversionVectors"]!
+      encoder.setComputePipelineState(pipeline)
+      encoder.setBuffer(inputBuffer, offset: 0, index: 0)
+      encoder.setBuffer(outputBuffer, offset: 0, index: 1)
+      encoder.dispatchThreads(
+        MTLSizeMake(count, 1, 1), threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+    }
+
+    let output = outputBuffer.contents().assumingMemoryBound(to: UInt32.self)
+    for i in 0..<count {
+      for j in 0..<4 {
+        let vector = output[8 * i + j]
+        let scalar = output[8 * i + 4 + j]
+        XCTAssertEqual(vector, scalar, "Element \(j) of vector \(i)")
+      }
+    }
+  }
+
+  // Reports how many round trips (double -> T -> double) each format achieves
+  // per second.
+  func testConversionThroughput() throws {
+    let numThreads = 1 << 16
+    let iterations = 256
+
+    func benchmark(_ name: String) {
+      let device = Context.global.device
+      let data = [Double](repeating: 0.3, count: numThreads)
+      let dataBuffer = device.makeBuffer(bytes: data, length: numThreads * 8)!
+      let pipeline = Context.global.pipelines["benchmarkConversion" + name]!
+
+      let commandBuffer = Context.global.withCommandBuffer { commandBuffer in
+        let encoder = commandBuffer.makeComputeCommandEncoder()!
+        encoder.setComputePipelineState(pipeline)
+        var _iterations = UInt32(iterations)
+        encoder.setBytes(&_iterations, length: 4, index: 0)
+        encoder.setBuffer(dataBuffer, offset: 0, index: 1)
+        encoder.dispatchThreads(
+          MTLSizeMake(numThreads, 1, 1),
+          threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+        encoder.endEncoding()
+        return commandBuffer
+      }
+
+      let seconds = commandBuffer.gpuEndTime - commandBuffer.gpuStartTime
+      let roundTrips = Double(numThreads * iterations)
+      print("\(name): \(roundTrips / seconds / 1e9) G round trips/s")
+    }
+
+    // Running twice prevents the first run from including warmup time.
+    for _ in 0..<2 {
+      for name in ["Float", "Half", "Long", "Float32x2", "Float59", "Float43"] {
+        benchmark(name)
+      }
+    }
+  }
+}
+
+// Mixes random bit patterns (including INF, NAN, and denormals) with values
+// near the rounding and overflow boundaries of each format.
+private func generateConversionInputs(count: Int) -> [Double] {
+  let specials: [Double] = [
+    0, -0, .infinity, -.infinity, .nan, 0.5, 1.5, 2.5, -2.5, 65504, 65520,
+    Double(Float.greatestFiniteMagnitude), 0x1p63, -0x1p63, 0x1p31 - 0.5,
+    -0x1p31 - 0.5, .leastNonzeroMagnitude, .greatestFiniteMagnitude,
+    // Ties for `float59_t` and `float43_t`
+    1 + 0x1p-48, 1 + 0x1.8p-47, 1 + 0x1p-32, 1 + 0x1.8p-31
+  ]
+  return (0..<count).map { i in
+    switch i % 5 {
+    case 0:
+      return Double(bitPattern: UInt64.random(in: 0...UInt64.max))
+    case 1:
+      return specials.randomElement()!
+    case 2:
+      // Half and float denormals
+      return Double.random(in: -1...1) * 0x1p-130
+    case 3:
+      return Double.random(in: -1...1) * 0x1p17
+    default:
+      return Double.random(in: -1...1) * 0x1p64
+    }
+  }
+}
+
+private func same<T: BinaryFloatingPoint>(_ lhs: T, _ rhs: T) -> Bool {
+  (lhs.isNaN && rhs.isNaN) || (lhs == rhs && lhs.sign == rhs.sign)
+}
+
+private func truncateToFloat(_ x: Double) -> Float {
+  let rounded = Float(x)
+  if rounded.isNaN || abs(Double(rounded)) <= abs(x) {
+    return rounded
+  }
+  return rounded.nextToward(0)
+}
+
+// `Float16` is unavailable on Intel Macs, so `half` is handled as its bit
+// pattern. Rounds with the same scaling as `reduce`, then encodes the result.
+private func roundToHalf(
+  _ x: Double, _ rule: FloatingPointRoundingRule
+) -> UInt16 {
+  let sign: UInt16 = (x.sign == .minus) ? 0x8000 : 0
+  if x.isNaN {
+    return 0x7E00
+  } else if x.isInfinite {
+    return sign | 0x7C00
+  }
+
+  // Denormals share the quantum of the smallest normal binade, 2^-14.
+  let exponent = max(Int(x.exponent), -14)
+  let quantum = Double(sign: .plus, exponent: exponent - 10, significand: 1)
+  let magnitude = (abs(x) / quantum).rounded(rule) * quantum
+  if magnitude >= 0x1p16 {
+    // Rounding toward zero saturates to the largest finite number.
+    return sign | ((rule == .towardZero) ? 0x7BFF : 0x7C00)
+  } else if magnitude < 0x1p-14 {
+    return sign | UInt16(magnitude * 0x1p24)
+  }
+  let biasedExponent = UInt16(Int(magnitude.exponent) + 15)
+  let significand = magnitude.significand
+  return sign | (biasedExponent << 10) | UInt16((significand - 1) * 1024)
+}
+
+private func widenHalf(_ bits: UInt16) -> Double {
+  let sign: Double = (bits & 0x8000 == 0) ? 1 : -1
+  let biasedExponent = Int(bits >> 10) & 0x1F
+  let fraction = Double(bits & 0x3FF)
+  switch biasedExponent {
+  case 0:
+    return sign * fraction * 0x1p-24
+  case 31:
+    return (fraction == 0) ? sign * .infinity : .nan
+  default:
+    let scale = Double(sign: .plus, exponent: biasedExponent - 15, significand: 1)
+    return sign * (1 + fraction / 1024) * scale
+  }
+}
+
+private func sameHalf(_ lhs: UInt16, _ rhs: UInt16) -> Bool {
+  let isNaN = { (bits: UInt16) in bits & 0x7FFF > 0x7C00 }
+  return (isNaN(lhs) && isNaN(rhs)) || lhs == rhs
+}
+
+// Swift traps on out-of-range conversions, while MetalFloat64 saturates.
+private func saturatingCast<T: FixedWidthInteger>(_ x: Double) -> T {
+  if x.isNaN {
+    return 0
+  } else if x >= Double(T.max) {
+    return T.max
+  } else if x <= Double(T.min) {
+    return T.min
+  } else {
+    return T(x)
+  }
+}
+
+// Rounds to `fractionBits` explicit mantissa bits with the same exponent range
+// as `double`, then returns the bit pattern. Scales `x` so the last kept bit
+// has a value of 1, rounds to an integer, and scales back. Both scalings are
+// exact, except for overflowing to INF.
+private func reduce(
+  _ x: Double, _ fractionBits: Int, _ rule: FloatingPointRoundingRule
+) -> UInt64 {
+  if x.isNaN {
+    // Quiets the NAN, and drops the payload's lowest bits.
+    let mask: UInt64 = (1 << (52 - fractionBits)) - 1
+    return (x.bitPattern | 0x0008_0000_0000_0000) & ~mask
+  } else if x.isInfinite || x == 0 {
+    return x.bitPattern
+  }
+
+  // Denormals share the quantum of the smallest normal binade.
+  let exponent = max(Int(x.exponent), Int(Double.leastNormalMagnitude.exponent))
+  let quantum = Double(sign: .plus, exponent: exponent - fractionBits, significand: 1)
+  return ((x / quantum).rounded(rule) * quantum).bitPattern
+}
+
+private extension BinaryFloatingPoint {
+  func nextToward(_ target: Self) -> Self {
+    self > target ? nextDown : nextUp
+  }
+}
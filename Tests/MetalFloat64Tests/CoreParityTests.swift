@@ -0,0 +1,164 @@
+import XCTest
+import MetalFloat64Core
+
+// Checks that the portable core in "MetalFloat64Core" produces the same bits
+// as the MSL headers, either with both running on the GPU or with the core
+// running on the host.
+final class CoreParityTests: XCTestCase {
+  func testCoreParityFloat64() throws {
+    let count = 1 << 16
+    let input = (0..<2 * count).map { i -> Double in
+      if i % 2 == 0 {
+        return Double(bitPattern: .random(in: 0 ... .max))
+      } else {
+        return .random(in: -1...1) * pow(2, Double(Int.random(in: -60...60)))
+      }
+    }
+    let output: [UInt64] = runParityKernel(
+      "testCoreParityFloat64", input: input, threadCount: count,
+      outputsPerThread: 6)
+
+    for i in 0..<3 * count {
+      guard output[2 * i] == output[2 * i + 1] else {
+        XCTFail("Operation \(i % 3) at \(i / 3)")
+        return
+      }
+    }
+  }
+
+  func testCoreParityFloat32x2() throws {
+    let count = 1 << 16
+    let input = (0..<3 * count).map { _ -> SIMD2<Float> in
+      let x = Double.random(in: -1...1) * pow(2, Double(Int.random(in: -30...30)))
+      let hi = Float(x)
+      return SIMD2(hi, Float(x - Double(hi)))
+    }
+    let output: [SIMD2<Float>] = runParityKernel(
+      "testCoreParityFloat32x2", input: input, threadCount: count,
+      outputsPerThread: 8)
+
+    for i in 0..<4 * count {
+      guard output[2 * i] == output[2 * i + 1] else {
+        XCTFail("Operation \(i % 4) at \(i / 4)")
+        return
+      }
+    }
+  }
+
+  // Runs the MSL error-free transformations on the GPU, then compares them
+  // against the portable core on the host. Unlike the tests above, the two
+  // sides come from different compilers and hardware, so this also catches
+  // differences in contraction or denormal handling. Inputs keep the `float`
+  // errors normal, and cover the entire finite range of `double`.
+  func testCoreParityErrorFree() throws {
+    let count = 1 << 16
+    let input = (0..<2 * count).map { i -> Double in
+      switch i % 4 {
+      case 0:
+        let magnitude = Double(bitPattern: .random(in: 0...0x7FEF_FFFF_FFFF_FFFF))
+        return Bool.random() ? magnitude : -magnitude
+      case 1:
+        // Within 2^28 ulps of the largest finite number
+        let magnitude = Double(
+          bitPattern: 0x7FEF_FFFF_FFFF_FFFF - .random(in: 0..<(1 << 28)))
+        return Bool.random() ? magnitude : -magnitude
+      default:
+        return .random(in: -1...1) * pow(2, Double(Int.random(in: -60...60)))
+      }
+    }
+    let floatInput = (0..<2 * count).map { i -> Float in
+      if i % 4 == 1 {
+        let magnitude = Float(
+          bitPattern: 0x7F7F_FFFF - .random(in: 0..<(1 << 14)))
+        return Bool.random() ? magnitude : -magnitude
+      }
+      return Float(.random(in: -1...1) * pow(2, Double(Int.random(in: -30...30))))
+    }
+    let device = Context.global.device
+    let inputBuffer = device.makeBuffer(bytes: input, length: input.count * 8)!
+    let floatInputBuffer = device.makeBuffer(
+      bytes: floatInput, length: floatInput.count * 4)!
+    let outputBuffer = device.makeBuffer(length: 8 * count * 8)!
+    let floatOutputBuffer = device.makeBuffer(length: 8 * count * 4)!
+    let mismatchBuffer = device.makeBuffer(length: count * 4)!
+
+    Context.global.withComputeEncoder { encoder in
+      let pipeline = Context.global.pipelines["testCoreParityErrorFree"]!
+      encoder.setComputePipelineState(pipeline)
+      encoder.setBuffer(inputBuffer, offset: 0, index: 0)
+      encoder.setBuffer(floatInputBuffer, offset: 0, index: 1)
+      encoder.setBuffer(outputBuffer, offset: 0, index: 2)
+      encoder.setBuffer(floatOutputBuffer, offset: 0, index: 3)
+      encoder.setBuffer(mismatchBuffer, offset: 0, index: 4)
+      encoder.dispatchThreads(
+        MTLSizeMake(count, 1, 1), threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+    }
+
+    let output = outputBuffer.contents().assumingMemoryBound(to: UInt64.self)
+    let floatOutput = floatOutputBuffer.contents()
+      .assumingMemoryBound(to: UInt32.self)
+    let mismatches = mismatchBuffer.contents()
+      .assumingMemoryBound(to: UInt32.self)
+    for i in 0..<count {
+      let x = input[2 * i], y = input[2 * i + 1]
+      let a = mf64_float64_t(data: x.bitPattern)
+      let b = mf64_float64_t(data: y.bitPattern)
+      let ordered = abs(x) >= abs(y)
+      let expected = [
+        mf64_float64_two_sum(a, b), mf64_float64_two_prod(a, b),
+        mf64_float64_split(a),
+        ordered
+          ? mf64_float64_fast_two_sum(a, b) : mf64_float64_fast_two_sum(b, a)
+      ].flatMap { [$0.hi.data, $0.lo.data] }
+
+      let fx = floatInput[2 * i], fy = floatInput[2 * i + 1]
+      let floatOrdered = abs(fx) >= abs(fy)
+      let floatExpected = [
+        mf64_two_sum(fx, fy), mf64_two_prod(fx, fy), mf64_split(fx),
+        floatOrdered ? mf64_fast_two_sum(fx, fy) : mf64_fast_two_sum(fy, fx)
+      ].flatMap { [$0.hi.bitPattern, $0.lo.bitPattern] }
+
+      // Results that overflow are outside the contract, and NAN bits may vary.
+      for j in 0..<8 {
+        let isFinite = Double(bitPattern: expected[j & ~1]).isFinite
+        guard !isFinite || output[8 * i + j] == expected[j] else {
+          XCTFail("Output \(j) at (\(x), \(y))")
+          return
+        }
+        let isFloatFinite = Float(bitPattern: floatExpected[j & ~1]).isFinite
+        guard !isFloatFinite || floatOutput[8 * i + j] == floatExpected[j] else {
+          XCTFail("Float output \(j) at (\(fx), \(fy))")
+          return
+        }
+      }
+      guard mismatches[i] == 0 else {
+        XCTFail("Vector mismatches \(mismatches[i]) at (\(x), \(y), \(fx), \(fy))")
+        return
+      }
+    }
+  }
+}
+
+private func runParityKernel<T, U>(
+  _ name: String, input: [T], threadCount: Int, outputsPerThread: Int
+) -> [U] {
+  let outputCount = threadCount * outputsPerThread
+  let device = Context.global.device
+  let inputBuffer = device.makeBuffer(
+    bytes: input, length: input.count * MemoryLayout<T>.stride)!
+  let outputBuffer = device.makeBuffer(
+    length: outputCount * MemoryLayout<U>.stride)!
+
+  Context.global.withComputeEncoder { encoder in
+    let pipeline = Context.global.pipelines[name]!
+    encoder.setComputePipelineState(pipeline)
+    encoder.setBuffer(inputBuffer, offset: 0, index: 0)
+    encoder.setBuffer(outputBuffer, offset: 0, index: 1)
+    encoder.dispatchThreads(
+      MTLSizeMake(threadCount, 1, 1),
+      threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+  }
+
+  let output = outputBuffer.contents().assumingMemoryBound(to: U.self)
+  return Array(UnsafeBufferPointer(start: output, count: outputCount))
+}
@@ -0,0 +1,159 @@
+import XCTest
+
+final class PolynomialTests: XCTestCase {
+  // Taylor series of exp(-x), matching the tables in "PolynomialTests.metal".
+  static let coefficients: [Double] = (0..<14).map { k in
+    let factorial = (1...max(k, 1)).reduce(1.0) { $0 * Double($1) }
+    return (k % 2 == 0 ? 1 : -1) / factorial
+  }
+
+  func testPolynomialFloat64() throws {
+    let count = 1 << 16
+    let input = (0..<count).map { _ in Double.random(in: -0.25...0.25) }
+    let exact = input.map { exp(-$0) }
+    let mixed = input.map { x in
+      Self.coefficients.reversed().reduce(0.0) { $0 * x + Double(Float($1)) }
+    }
+
+    for (name, expected) in [
+      ("HornerFloat64", exact),
+      ("HornerFloat64Mixed", mixed),
+      ("EstrinFloat64", exact),
+      ("EstrinFloat64Mixed", mixed),
+    ] {
+      let output = runPolynomial(name, input: input)
+      for i in 0..<count {
+        // Allow rounding error in the CPU reference, which is not fused.
+        let tolerance = 4 * expected[i].ulp
+        guard abs(output[i] - expected[i]) <= tolerance else {
+          XCTFail("\(name) at \(input[i]): \(expected[i]) != \(output[i])")
+          break
+        }
+      }
+    }
+  }
+
+  func testPolynomialFloat32x2() throws {
+    let count = 1 << 16
+    let input = (0..<count).map { _ -> SIMD2<Float> in
+      let x = Double.random(in: -0.25...0.25)
+      let hi = Float(x)
+      return SIMD2(hi, Float(x - Double(hi)))
+    }
+    let inputDoubles = input.map { Double($0[0]) + Double($0[1]) }
+    let exact = inputDoubles.map { exp(-$0) }
+    let mixed = inputDoubles.map { x in
+      Self.coefficients.reversed().reduce(0.0) { $0 * x + Double(Float($1)) }
+    }
+
+    for (name, expected) in [
+      ("HornerFloat32x2", exact),
+      ("HornerFloat32x2Mixed", mixed),
+      ("EstrinFloat32x2", exact),
+      ("EstrinFloat32x2Mixed", mixed),
+    ] {
+      let output = runPolynomial(name, input: input)
+      for i in 0..<count {
+        let actual = Double(output[i][0]) + Double(output[i][1])
+        guard abs(actual - expected[i]) <= 1e-13 * abs(expected[i]) else {
+          XCTFail("\(name) at \(inputDoubles[i]): \(expected[i]) != \(actual)")
+          break
+        }
+      }
+    }
+  }
+
+  func testPolynomialVector() throws {
+    let count = 1 << 12
+    let input = (0..<2 * count).map { _ in Double.random(in: -0.25...0.25) }
+    let device = Context.global.device
+    let inputBuffer = device.makeBuffer(bytes: input, length: 2 * count * 8)!
+    let outputBuffer = device.makeBuffer(length: 4 * count * 8)!
+
+    Context.global.withComputeEncoder { encoder in
+      let pipeline = Context.global.pipelines["testPolynomialVector"]!
+      encoder.setComputePipelineState(pipeline)
+      encoder.setBuffer(inputBuffer, offset: 0, index: 0)
+      encoder.setBuffer(outputBuffer, offset: 0, index: 1)
+      encoder.dispatchThreads(
+        MTLSizeMake(count, 1, 1), threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+    }
+
+    let output = outputBuffer.contents().assumingMemoryBound(to: UInt64.self)
+    for i in 0..<count {
+      for j in 0..<2 {
+        let vector = output[4 * i + j]
+        let scalar = output[4 * i + 2 + j]
+        XCTAssertEqual(vector, scalar, "Element \(j) of vector \(i)")
+      }
+    }
+  }
+
+  // Reports how many degree-13 polynomials each configuration evaluates per
+  // second. Horner's scheme has a longer dependency chain, while Estrin's
+  // scheme has more operations.
+  func testPolynomialThroughput() throws {
+    let numThreads = 1 << 16
+    let iterations = 256
+
+    // Both types are 8 bytes, so initialize each thread's value from its bit
+    // pattern.
+    func benchmark(_ name: String, initialValue: UInt64) {
+      let device = Context.global.device
+      let data = [UInt64](repeating: initialValue, count: numThreads)
+      let dataBuffer = device.makeBuffer(bytes: data, length: numThreads * 8)!
+      let pipeline = Context.global.pipelines["benchmarkPolynomial" + name]!
+
+      let commandBuffer = Context.global.withCommandBuffer { commandBuffer in
+        let encoder = commandBuffer.makeComputeCommandEncoder()!
+        encoder.setComputePipelineState(pipeline)
+        var _iterations = UInt32(iterations)
+        encoder.setBytes(&_iterations, length: 4, index: 0)
+        encoder.setBuffer(dataBuffer, offset: 0, index: 1)
+        encoder.dispatchThreads(
+          MTLSizeMake(numThreads, 1, 1),
+          threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+        encoder.endEncoding()
+        return commandBuffer
+      }
+
+      let seconds = commandBuffer.gpuEndTime - commandBuffer.gpuStartTime
+      let evaluations = Double(numThreads * iterations)
+      print("\(name): \(evaluations / seconds / 1e9) G polynomials/s")
+    }
+
+    // Running twice prevents the first run from including warmup time.
+    let float64Half = Double(0.5).bitPattern
+    let float32x2Half = UInt64(Float(0.5).bitPattern)
+    for _ in 0..<2 {
+      benchmark("HornerFloat64", initialValue: float64Half)
+      benchmark("HornerFloat64Mixed", initialValue: float64Half)
+      benchmark("EstrinFloat64", initialValue: float64Half)
+      benchmark("EstrinFloat64Mixed", initialValue: float64Half)
+      benchmark("HornerFloat32x2", initialValue: float32x2Half)
+      benchmark("HornerFloat32x2Mixed", initialValue: float32x2Half)
+      benchmark("EstrinFloat32x2", initialValue: float32x2Half)
+      benchmark("EstrinFloat32x2Mixed", initialValue: float32x2Half)
+    }
+  }
+}
+
+private func runPolynomial<T>(_ name: String, input: [T]) -> [T] {
+  let count = input.count
+  let stride = MemoryLayout<T>.stride
+  let device = Context.global.device
+  let inputBuffer = device.makeBuffer(bytes: input, length: count * stride)!
+  let outputBuffer = device.makeBuffer(length: count * stride)!
+
+  Context.global.withComputeEncoder { encoder in
+    let pipeline = Context.global.pipelines["testPolynomial" + name]!
+    encoder.setComputePipelineState(pipeline)
+    encoder.setBuffer(inputBuffer, offset: 0, index: 0)
+    encoder.setBuffer(outputBuffer, offset: 0, index: 1)
+    encoder.dispatchThreads(
+      MTLSizeMake(count, 1, 1), threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+  }
+
+  let output = outputBuffer.contents().assumingMemoryBound(to: T.self)
+  return Array(UnsafeBufferPointer(start: output, count: count))
+}
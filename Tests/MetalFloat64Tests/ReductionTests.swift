@@ -0,0 +1,264 @@
+import XCTest
+
+final class ReductionTests: XCTestCase {
+  // Order of the six outputs per thread in "ReductionTests.metal".
+  static let outputNames = [
+    "sum", "inclusive sum", "exclusive sum",
+    "compensated sum", "compensated inclusive sum",
+    "compensated exclusive sum"
+  ]
+
+  // The emulated addition is correctly rounded, so replaying the same order of
+  // additions in `Double` reproduces the GPU bit for bit. Compensated sums
+  // should be within a few ulp of the exact result instead.
+  func testReductionFloat64() throws {
+    let input = generateReductionInputs(count: 1 << 14)
+    for scope in [ReductionScope.simdgroup, .threadgroup(256)] {
+      let output = runReduction(scope, "Float64", input: input)
+      let expected = simulateReduction(scope, input: input)
+      let exact = exactReduction(scope, input: input)
+
+      for i in 0..<input.count {
+        for j in 0..<6 {
+          let actual = output[6 * i + j]
+          let name = "\(scope) \(Self.outputNames[j]) at \(i)"
+          if j < 3 {
+            guard actual.bitPattern == expected[j][i].bitPattern else {
+              XCTFail("\(name): \(expected[j][i]) != \(actual)")
+              return
+            }
+          } else {
+            let tolerance = 4 * exact[j - 3][i].ulp
+            guard abs(actual - exact[j - 3][i]) <= tolerance else {
+              XCTFail("\(name): \(exact[j - 3][i]) != \(actual)")
+              return
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // The double-single addition is not correctly rounded, so allow error
+  // relative to the largest input.
+  func testReductionFloat32x2() throws {
+    let doubles = generateReductionInputs(count: 1 << 14)
+    let input = doubles.map { x -> SIMD2<Float> in
+      let hi = Float(x)
+      return SIMD2(hi, Float(x - Double(hi)))
+    }
+    let inputDoubles = input.map { Double($0[0]) + Double($0[1]) }
+    let scale = inputDoubles.map(abs).max()!
+
+    for scope in [ReductionScope.simdgroup, .threadgroup(256)] {
+      let output = runReduction(scope, "Float32x2", input: input)
+      let exact = exactReduction(scope, input: inputDoubles)
+
+      for i in 0..<input.count {
+        for j in 0..<6 {
+          let pair = output[6 * i + j]
+          let actual = Double(pair[0]) + Double(pair[1])
+          guard abs(actual - exact[j % 3][i]) <= 1e-12 * scale else {
+            let name = "\(scope) \(Self.outputNames[j]) at \(i)"
+            XCTFail("\(name): \(exact[j % 3][i]) != \(actual)")
+            return
+          }
+        }
+      }
+    }
+  }
+
+  // Reports how many elements each SIMD-group reduction consumes per second.
+  func testReductionThroughput() throws {
+    let numThreads = 1 << 16
+    let iterations = 256
+
+    // Both types are 8 bytes, so initialize each thread's value from its bit
+    // pattern.
+    func benchmark(_ name: String, initialValue: UInt64) {
+      let device = Context.global.device
+      let data = [UInt64](repeating: initialValue, count: numThreads)
+      let dataBuffer = device.makeBuffer(bytes: data, length: numThreads * 8)!
+      let pipeline = Context.global.pipelines["benchmarkReduction" + name]!
+
+      let commandBuffer = Context.global.withCommandBuffer { commandBuffer in
+        let encoder = commandBuffer.makeComputeCommandEncoder()!
+        encoder.setComputePipelineState(pipeline)
+        var _iterations = UInt32(iterations)
+        encoder.setBytes(&_iterations, length: 4, index: 0)
+        encoder.setBuffer(dataBuffer, offset: 0, index: 1)
+        encoder.dispatchThreads(
+          MTLSizeMake(numThreads, 1, 1),
+          threadsPerThreadgroup: MTLSizeMake(64, 1, 1))
+        encoder.endEncoding()
+        return commandBuffer
+      }
+
+      let seconds = commandBuffer.gpuEndTime - commandBuffer.gpuStartTime
+      let elements = Double(numThreads * iterations)
+      print("\(name): \(elements / seconds / 1e9) G elements/s")
+    }
+
+    // Running twice prevents the first run from including warmup time.
+    let float64Half = Double(0.5).bitPattern
+    let float32x2Half = UInt64(Float(0.5).bitPattern)
+    for _ in 0..<2 {
+      benchmark("Float64", initialValue: float64Half)
+      benchmark("Float64Compensated", initialValue: float64Half)
+      benchmark("Float32x2", initialValue: float32x2Half)
+      benchmark("Float32x2Compensated", initialValue: float32x2Half)
+    }
+  }
+}
+
+private enum ReductionScope: CustomStringConvertible {
+  case simdgroup
+  case threadgroup(Int)
+
+  var groupSize: Int {
+    switch self {
+    case .simdgroup: return 32
+    case .threadgroup(let size): return size
+    }
+  }
+
+  var description: String {
+    switch self {
+    case .simdgroup: return "SIMD-group"
+    case .threadgroup: return "threadgroup"
+    }
+  }
+}
+
+// Mixes magnitudes and signs, with some neighbors cancelling each other out.
+private func generateReductionInputs(count: Int) -> [Double] {
+  var output = (0..<count).map { _ in
+    Double.random(in: -1...1) * pow(2, Double(Int.random(in: -20...20)))
+  }
+  for i in stride(from: 0, to: count, by: 8) {
+    output[i + 1] = -output[i] * (1 + 0x1p-30)
+  }
+  return output
+}
+
+private func runReduction<T>(
+  _ scope: ReductionScope, _ name: String, input: [T]
+) -> [T] {
+  let count = input.count
+  let stride = MemoryLayout<T>.stride
+  let device = Context.global.device
+  let inputBuffer = device.makeBuffer(bytes: input, length: count * stride)!
+  let outputBuffer = device.makeBuffer(length: 6 * count * stride)!
+
+  let prefix: String
+  switch scope {
+  case .simdgroup: prefix = "testSimdReduction"
+  case .threadgroup: prefix = "testThreadgroupReduction"
+  }
+  Context.global.withComputeEncoder { encoder in
+    let pipeline = Context.global.pipelines[prefix + name]!
+    encoder.setComputePipelineState(pipeline)
+    encoder.setBuffer(inputBuffer, offset: 0, index: 0)
+    encoder.setBuffer(outputBuffer, offset: 0, index: 1)
+    encoder.dispatchThreads(
+      MTLSizeMake(count, 1, 1),
+      threadsPerThreadgroup: MTLSizeMake(scope.groupSize, 1, 1))
+  }
+
+  let output = outputBuffer.contents().assumingMemoryBound(to: T.self)
+  return Array(UnsafeBufferPointer(start: output, count: 6 * count))
+}
+
+// MARK: - SIMD-Group Simulation
+
+// Models the shuffles in "Reduction.h" on the CPU. Each function takes the 32
+// lanes of one SIMD-group.
+
+// Butterfly reduction with `simd_shuffle_xor`.
+private func simulateSimdSum(_ lanes: [Double]) -> Double {
+  var lanes = lanes
+  var mask = 1
+  while mask < 32 {
+    lanes = lanes.indices.map { lanes[$0] + lanes[$0 ^ mask] }
+    mask *= 2
+  }
+  return lanes[0]
+}
+
+// Hillis-Steele scan with `simd_shuffle_up`.
+private func simulateSimdPrefixInclusive(_ lanes: [Double]) -> [Double] {
+  var lanes = lanes
+  var delta = 1
+  while delta < 32 {
+    lanes = lanes.indices.map { i in
+      i >= delta ? lanes[i - delta] + lanes[i] : lanes[i]
+    }
+    delta *= 2
+  }
+  return lanes
+}
+
+private func simulateSimdPrefixExclusive(_ lanes: [Double]) -> [Double] {
+  [0] + simulateSimdPrefixInclusive(lanes).dropLast()
+}
+
+// Returns the (sum, inclusive scan, exclusive scan) for every thread.
+private func simulateReduction(
+  _ scope: ReductionScope, input: [Double]
+) -> [[Double]] {
+  var output = [[Double]](repeating: [], count: 3)
+  for group in stride(from: 0, to: input.count, by: scope.groupSize) {
+    let simdgroups = (0..<scope.groupSize / 32).map { i in
+      Array(input[(group + 32 * i)..<(group + 32 * i + 32)])
+    }
+    switch scope {
+    case .simdgroup:
+      let lanes = simdgroups[0]
+      output[0] += Array(repeating: simulateSimdSum(lanes), count: 32)
+      output[1] += simulateSimdPrefixInclusive(lanes)
+      output[2] += simulateSimdPrefixExclusive(lanes)
+    case .threadgroup:
+      // Pad the partial results to a full SIMD-group with zeroes.
+      let padding = [Double](repeating: 0, count: 32 - simdgroups.count)
+      let partials = simdgroups.map(simulateSimdSum) + padding
+      let sum = simulateSimdSum(partials)
+      output[0] += Array(repeating: sum, count: scope.groupSize)
+
+      let prefixes = simdgroups.map(simulateSimdPrefixInclusive)
+      let totals = prefixes.map { $0.last! } + padding
+      let offsets = simulateSimdPrefixExclusive(totals)
+      for (i, prefix) in prefixes.enumerated() {
+        output[1] += prefix.map { offsets[i] + $0 }
+        output[2] += ([0] + prefix.dropLast()).map { offsets[i] + $0 }
+      }
+    }
+  }
+  return output
+}
+
+// Returns the (sum, inclusive scan, exclusive scan) for every thread, using
+// Neumaier summation in sequential order. For these inputs, it is within an
+// ulp of the exact result.
+private func exactReduction(
+  _ scope: ReductionScope, input: [Double]
+) -> [[Double]] {
+  var output = [[Double]](repeating: [], count: 3)
+  for group in stride(from: 0, to: input.count, by: scope.groupSize) {
+    var sum: Double = 0
+    var error: Double = 0
+    var inclusive: [Double] = []
+    var exclusive: [Double] = []
+    for x in input[group..<(group + scope.groupSize)] {
+      exclusive.append(sum + error)
+      let newSum = sum + x
+      let (larger, smaller) = abs(sum) >= abs(x) ? (sum, x) : (x, sum)
+      error += smaller - (newSum - larger)
+      sum = newSum
+      inclusive.append(sum + error)
+    }
+    output[0] += Array(repeating: sum + error, count: scope.groupSize)
+    output[1] += inclusive
+    output[2] += exclusive
+  }
+  return output
+}
@@ -57,6 +57,19 @@ swift "${SWIFT_PACKAGE_DIR}/build.swift" \
 mv "${PACKAGED_LIBRARY_DIR}/include/MetalFloat64/MetalFloat64.h" \
   "${PACKAGED_LIBRARY_DIR}/include/metal_float64"
 
+# Copy the portable core, which "metal_float64" includes.
+CORE_SOURCE_DIR="${SWIFT_PACKAGE_DIR}/Sources/MetalFloat64Core"
+cp -r "${CORE_SOURCE_DIR}/include/MetalFloat64Core" \
+  "${PACKAGED_LIBRARY_DIR}/include/MetalFloat64Core"
+
+# Type-check the core's OpenCL branch. There is no OpenCL device to run it on.
+xcrun clang "${CORE_SOURCE_DIR}/tests/OpenCLTests.cl" \
+  -x cl \
+  -cl-std=CL1.2 \
+  -fsyntax-only \
+  -Werror \
+  -I "${CORE_SOURCE_DIR}/include"
+
 # Compile the library.
 # - Uses '-Os' to encourage force-noinlines to work correctly.
 # - '@rpath' causes a massive headache; use '@loader_path' instead. This means